@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Set of equally sized Bloom filters kept in a single array.
+// Database keeps one per main area page, covering the page and its overflow chains, and one for the guardian chain.
+class BloomFilters
+{
+public:
+    // Drops every key
+    void reset(size_t number_of_filters, size_t bits_per_filter);
+
+    void add(size_t filter, uint64_t key);
+
+    // Drops every key of a single filter
+    void clear(size_t filter);
+    // Puts count empty filters in front of the given one
+    void insert_empty(size_t filter, size_t count);
+
+    // False means the key was never added, true can be a false positive
+    bool may_contain(size_t filter, uint64_t key) const;
+
+    size_t size() const { return number_of_filters; }
+
+    // Returns false if the file is missing, holds filters of a different shape or was saved with a different generation
+    bool load(const std::string &path, size_t number_of_filters, size_t bits_per_filter, uint64_t generation);
+    void save(const std::string &path, uint64_t generation) const;
+
+private:
+    size_t number_of_filters = 0;
+    size_t bits_per_filter = 0;
+    size_t words_per_filter = 0;
+    std::vector<uint64_t> words;
+};
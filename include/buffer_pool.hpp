@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Buffer whose number of frames can be changed at runtime by BufferPool
+class ManagedBuffer
+{
+public:
+    virtual ~ManagedBuffer() = default;
+
+    virtual size_t get_number_of_frames() const = 0;
+    virtual void set_number_of_frames(size_t number_of_frames) = 0;
+
+    // Memory taken by a single frame
+    virtual size_t get_frame_size() const = 0;
+
+    // Number of pages in the underlying file, more frames than that are useless
+    virtual size_t get_number_of_pages() const = 0;
+
+    // Frames which are held by a PageGuard right now
+    virtual size_t get_pinned_frame_count() const = 0;
+
+    // Counters which are never cleared, pool looks at their growth between rebalances
+    virtual size_t get_total_hit_count() const = 0;
+    virtual size_t get_total_miss_count() const = 0;
+};
+
+// Splits one memory budget between several page buffers.
+// Buffers with higher priority are satisfied first, the rest of the budget follows observed misses.
+class BufferPool
+{
+public:
+    explicit BufferPool(size_t memory_budget);
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    void attach(ManagedBuffer &buffer, bool has_priority = false);
+
+    // Redistribute frames, skipped while any page is pinned
+    void rebalance();
+
+    // Print buffers which still have pinned frames through DEBUG_CERR, returns number of such frames.
+    // Between operations nothing should be pinned, so anything reported is a leaked guard.
+    size_t report_pinned_frames() const;
+
+    // Count operation and rebalance every Settings::BUFFER_POOL_REBALANCE_INTERVAL operations
+    void on_operation();
+
+    size_t get_memory_budget() const { return memory_budget; }
+
+private:
+    struct Member
+    {
+        ManagedBuffer *buffer;
+        bool has_priority;
+        size_t last_hit_count = 0;
+        size_t last_miss_count = 0;
+    };
+
+    std::vector<Member> members;
+    size_t memory_budget;
+    size_t operations_since_rebalance = 0;
+};
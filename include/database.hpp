@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <optional>
+#include <ostream>
+#include <span>
+#include <utility>
 #include <vector>
-#include <tuple>
+
+#include "key_value_source.hpp"
 #include "page_buffer.hpp"
-#include "structures.hpp"
 #include "settings.hpp"
 
 enum class OperationType
@@ -14,16 +19,96 @@ enum class OperationType
     UPDATE,
     REMOVE,
     REORGANISE,
-    PRINT
+    PRINT,
+    BULK_LOAD,
+    SCAN,
+    MULTI_SEARCH,
+    UPSERT,
+    INSERT_IF_ABSENT,
+    COMPARE_AND_SET
 };
 
 std::ostream &operator<<(std::ostream &os, OperationType operation);
 
+enum class ReorganisationMode
+{
+    // Whole database is rewritten into new files
+    FULL,
+    // Only main area pages with long overflow chains are merged, falling back to full reorganisation when that frees no slot
+    INCREMENTAL,
+    // Whole database is rewritten by another thread while lookups keep using the old files,
+    // writes wait in memory until the new files are installed
+    BACKGROUND
+};
+
+struct DatabaseOptions
+{
+    size_t memory_budget = Settings::DEFAULT_MEMORY_BUDGET;
+    BufferOptions buffer_options;
+    // Index and main area are read-mostly between reorganisations and can be memory mapped
+    StorageMode index_and_main_storage = StorageMode::BUFFERED;
+    // Entries per page of a newly created database, existing databases keep the one in their headers
+    size_t blocking_factor = Settings::DEFAULT_BLOCKING_FACTOR;
+    IndexMode index_mode = Settings::DEFAULT_INDEX_MODE;
+    // Used when an insert finds the overflow area full, can be changed with --reorganisation full|incremental
+    ReorganisationMode reorganisation_mode = ReorganisationMode::FULL;
+};
+
+// Operations of a database, implemented once for every supported blocking factor
+class DatabaseEngine
+{
+public:
+    virtual ~DatabaseEngine() = default;
+
+    virtual void print() = 0;
+
+    virtual void print_stats() = 0;
+
+    virtual std::optional<uint64_t> search(uint64_t key) = 0;
+
+    // Results come in the order of the keys, stats are printed once for the whole batch
+    virtual std::vector<std::optional<uint64_t>> multi_search(std::span<const uint64_t> keys) = 0;
+
+    virtual void insert(uint64_t key, uint64_t value) = 0;
+
+    virtual void update(uint64_t key, uint64_t value) = 0;
+
+    // Inserts the key or updates its value
+    virtual void upsert(uint64_t key, uint64_t value) = 0;
+
+    // Returns false and changes nothing when the key exists
+    virtual bool insert_if_absent(uint64_t key, uint64_t value) = 0;
+
+    // Sets the value only when the key exists with the expected value, returns whether it did
+    virtual bool compare_and_set(uint64_t key, uint64_t expected, uint64_t value) = 0;
+
+    virtual void remove(uint64_t key) = 0;
+
+    virtual void reorganise() = 0;
+
+    virtual void reorganise_incremental() = 0;
+
+    // Merges sorted pairs into the database, rewriting it the way reorganisation does.
+    // Keys which are already in the database keep their values.
+    virtual void bulk_load(KeyValueSource &source) = 0;
+
+    // Live pairs with keys in [lo, hi] in key order. The database mustn't be changed until the source is destroyed,
+    // which prints the stats of the scan.
+    virtual std::unique_ptr<KeyValueSource> scan(uint64_t lo, uint64_t hi) = 0;
+
+    virtual void flush() = 0;
+
+    virtual size_t get_blocking_factor() const = 0;
+};
+
+// Largest supported blocking factor whose main area page fits in page_size bytes
+size_t blocking_factor_for_page_size(size_t page_size);
+
+// Opens the engine matching the blocking factor stored in the database files
 struct Database
 {
 public:
-    Database();
-    ~Database();
+    explicit Database(const DatabaseOptions &options = {});
 
     Database(const Database &) = delete;
     Database &operator=(const Database &) = delete;
@@ -33,51 +118,46 @@ public:
 
     static void delete_files();
 
-    void print();
+    size_t get_blocking_factor() const { return engine->get_blocking_factor(); }
 
-    void print_stats();
+    void print() { engine->print(); }
 
-    std::optional<uint64_t> search(uint64_t key);
+    void print_stats() { engine->print_stats(); }
 
-    void insert(uint64_t key, uint64_t value);
+    std::optional<uint64_t> search(uint64_t key) { return engine->search(key); }
 
-    void update(uint64_t key, uint64_t value);
+    std::vector<std::optional<uint64_t>> multi_search(std::span<const uint64_t> keys) { return engine->multi_search(keys); }
 
-    void remove(uint64_t key);
+    void insert(uint64_t key, uint64_t value) { engine->insert(key, value); }
 
-    void reorganise();
+    void update(uint64_t key, uint64_t value) { engine->update(key, value); }
 
-    void flush();
+    void upsert(uint64_t key, uint64_t value) { engine->upsert(key, value); }
 
-private:
-    // Helper methods
-    std::optional<std::reference_wrapper<PageEntry>> search_for_entry(uint64_t key);
-    std::optional<std::reference_wrapper<PageEntry>> search_overflow_chain(size_t start_index, uint64_t key);
-    std::tuple<std::optional<std::pair<size_t, size_t>>, double> find_overflow_position();
-    size_t insert_overflow_entry(size_t page_index, size_t entry_pos, uint64_t key, uint64_t value);
-    void link_overflow_entry(uint64_t &start_index, size_t new_entry_index);
-    size_t find_index_position(uint64_t key);
-    std::vector<PageEntry> gather_overflow_entries(size_t start_index);
-
-    std::optional<uint64_t> search_wrapper(uint64_t key);
+    bool insert_if_absent(uint64_t key, uint64_t value) { return engine->insert_if_absent(key, value); }
 
-    void print_wrapper();
+    bool compare_and_set(uint64_t key, uint64_t expected, uint64_t value) { return engine->compare_and_set(key, expected, value); }
 
-    void insert_wrapper(uint64_t key, uint64_t value);
+    void remove(uint64_t key) { engine->remove(key); }
 
-    void update_wrapper(uint64_t key, uint64_t value);
+    void reorganise() { engine->reorganise(); }
 
-    void remove_wrapper(uint64_t key);
+    void reorganise_incremental() { engine->reorganise_incremental(); }
 
-    void reorganise_wrapper();
+    void bulk_load(KeyValueSource &source) { engine->bulk_load(source); }
 
-    void print_stats_after_operation(OperationType operation);
+    // Pairs have to be sorted by key
+    void bulk_load(std::span<const std::pair<uint64_t, uint64_t>> pairs)
+    {
+        SpanKeyValueSource source(pairs);
+        engine->bulk_load(source);
+    }
 
-    void clear_counters();
+    // for (auto [key, value] : database.scan(lo, hi)), database mustn't be changed inside the loop
+    KeyValueRange scan(uint64_t lo, uint64_t hi) { return KeyValueRange(engine->scan(lo, hi)); }
 
-    Guardian guardian;
+    void flush() { engine->flush(); }
 
-    PageBuffer<IndexPage, Header> index_area;
-    PageBuffer<Page, MainAreaHeader> main_area;
-    PageBuffer<Page, Header> overflow_area;
+private:
+    std::unique_ptr<DatabaseEngine> engine;
 };
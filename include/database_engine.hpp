@@ -0,0 +1,295 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "bloom_filter.hpp"
+#include "buffer_pool.hpp"
+#include "database.hpp"
+#include "free_space_map.hpp"
+#include "page_buffer.hpp"
+#include "structures.hpp"
+#include "utils.hpp"
+#include "settings.hpp"
+#include "sparse_index.hpp"
+
+// Blocking factors an engine is compiled for
+using SupportedBlockingFactors = std::index_sequence<4, 8, 16, 64, 256, 1024>;
+
+// Where an entry lives, so it can be reacquired for writing
+struct EntryLocation
+{
+    bool in_overflow_area;
+    size_t page_index;
+    size_t entry_pos;
+};
+
+// Where a key is in an overflow chain, or where it would be inserted
+struct ChainPosition
+{
+    // Last entry with a smaller key
+    size_t prev_index = -1ULL;
+    bool prev_deleted = false;
+    // First entry whose key is not smaller, -1 at the end of the chain
+    size_t current_index = -1ULL;
+    bool current_deleted = false;
+    // Current entry holds the key
+    bool found = false;
+};
+
+// Main area page whose range holds a key, the range ends before the start key of the next page
+struct IndexRange
+{
+    size_t entry_pos = -1ULL;
+    std::optional<uint64_t> end_key;
+};
+
+template <size_t BlockingFactor>
+class BasicDatabase : public DatabaseEngine
+{
+public:
+    static constexpr size_t BLOCKING_FACTOR = BlockingFactor;
+    static constexpr size_t ENTRIES_AFTER_REORGANISATION = Settings::ALPHA * BlockingFactor;
+    static_assert(ENTRIES_AFTER_REORGANISATION > 0, "Blocking factor is too small");
+    static constexpr size_t BLOOM_FILTER_BITS = align_up(Settings::BLOOM_FILTER_BITS_PER_KEY * 2 * BlockingFactor, 64);
+
+    using IndexArea = PageBuffer<IndexPage<BlockingFactor>, IndexAreaHeader>;
+    using MainArea = PageBuffer<Page<BlockingFactor>, MainAreaHeader>;
+    using OverflowArea = PageBuffer<Page<BlockingFactor>, OverflowAreaHeader>;
+
+    explicit BasicDatabase(const DatabaseOptions &options);
+    ~BasicDatabase() override;
+
+    BasicDatabase(const BasicDatabase &) = delete;
+    BasicDatabase &operator=(const BasicDatabase &) = delete;
+
+    BasicDatabase(BasicDatabase &&) = delete;
+    BasicDatabase &operator=(BasicDatabase &&) = delete;
+
+    void print() override;
+
+    void print_stats() override;
+
+    std::optional<uint64_t> search(uint64_t key) override;
+
+    std::vector<std::optional<uint64_t>> multi_search(std::span<const uint64_t> keys) override;
+
+    void insert(uint64_t key, uint64_t value) override;
+
+    void update(uint64_t key, uint64_t value) override;
+
+    void upsert(uint64_t key, uint64_t value) override;
+
+    bool insert_if_absent(uint64_t key, uint64_t value) override;
+
+    bool compare_and_set(uint64_t key, uint64_t expected, uint64_t value) override;
+
+    void remove(uint64_t key) override;
+
+    void reorganise() override;
+
+    void reorganise_incremental() override;
+
+    void bulk_load(KeyValueSource &source) override;
+
+    std::unique_ptr<KeyValueSource> scan(uint64_t lo, uint64_t hi) override;
+
+    void flush() override;
+
+    size_t get_blocking_factor() const override { return BLOCKING_FACTOR; }
+
+private:
+    // Areas built by reorganisation, before they replace the current ones
+    struct ReorganisedAreas
+    {
+        std::unique_ptr<IndexArea> index_area;
+        std::unique_ptr<MainArea> main_area;
+        std::unique_ptr<OverflowArea> overflow_area;
+        SparseIndex sparse_index;
+        BloomFilters bloom_filters;
+    };
+
+    // Live entries of a range of leaf entries' main area pages in key order, every one followed by its overflow chain.
+    // Guardian chain comes before the first entry of the first page. Keeps one page of each area pinned.
+    class ReorganisationCursor
+    {
+    public:
+        ReorganisationCursor(MainArea &main_area, OverflowArea &overflow_area, const std::vector<IndexEntry> &leaf_entries, size_t begin, size_t end, uint64_t guardian_start);
+
+        // Returns false when the range is done
+        bool next(PageEntry &entry);
+
+    private:
+        MainArea &main_area;
+        OverflowArea &overflow_area;
+        const std::vector<IndexEntry> &leaf_entries;
+        size_t leaf_position;
+        size_t leaf_end;
+        uint64_t guardian_start;
+
+        typename MainArea::ConstPagePtr main_page;
+        size_t entry_position = 0;
+        typename OverflowArea::ConstPagePtr overflow_page;
+        // Next entry of the chain being walked
+        uint64_t chain_position = -1ULL;
+        // Main area entry waiting for the guardian chain
+        std::optional<PageEntry> pending_entry;
+    };
+
+    // Live pairs of a key range in the order search sees them, the guardian chain first, then every main area page
+    // with the chains of its entries. Main area pages are read ahead together with the overflow pages their chains
+    // start on, through scan readers, so the pages in the buffers stay where they are.
+    class ScanCursor : public KeyValueSource
+    {
+    public:
+        ScanCursor(BasicDatabase &database, uint64_t lo, uint64_t hi);
+        ~ScanCursor() override;
+
+        bool next(uint64_t &key, uint64_t &value) override;
+
+    private:
+        // Next live pair of the areas, without the writes waiting in the delta
+        bool next_in_areas(uint64_t &key, uint64_t &value);
+        // Returns false past the end of the leaf level
+        bool read_leaf_entry(IndexEntry &entry);
+        // Moves to the next main area page, keeping the following ones and their overflow pages on their way
+        bool advance_main_page();
+
+        BasicDatabase &database;
+        uint64_t lo;
+        uint64_t hi;
+
+        typename IndexArea::ScanReader index_reader;
+        typename MainArea::ScanReader main_reader;
+        typename OverflowArea::ScanReader overflow_reader;
+
+        // Leaf level is read once in order, main area pages of the entries read so far wait here
+        size_t next_leaf_position = 0;
+        size_t leaf_end = 0;
+        std::deque<size_t> upcoming_pages;
+
+        const Page<BlockingFactor> *main_page = nullptr;
+        size_t entry_position = 0;
+        // Next entry of the chain being walked
+        uint64_t chain_position = -1ULL;
+        bool done = false;
+
+        // Writes made during background reorganisation are merged in, they replace the pairs of the old areas
+        std::map<uint64_t, std::optional<uint64_t>>::const_iterator delta_position;
+        std::map<uint64_t, std::optional<uint64_t>>::const_iterator delta_end;
+        // Pair read from the areas which wasn't handed out yet
+        std::optional<std::pair<uint64_t, uint64_t>> area_pair;
+    };
+
+    // When conditional_write stores the value, depending on the current one
+    enum class WriteCondition
+    {
+        ALWAYS,
+        IF_ABSENT,
+        IF_EQUAL
+    };
+
+    // Helper methods
+    std::optional<EntryLocation> search_for_entry(uint64_t key);
+    std::optional<EntryLocation> search_from_index_position(size_t entry_pos, uint64_t key);
+    std::optional<EntryLocation> search_overflow_chain(size_t start_index, uint64_t key);
+    void search_overflow_chain(size_t start_index, std::span<const uint64_t> keys, std::span<std::optional<uint64_t>> values);
+    void search_page_group(size_t entry_pos, std::span<const uint64_t> keys, std::span<std::optional<uint64_t>> values);
+    typename OverflowArea::PagePtr get_page_for_write(const EntryLocation &location);
+    bool overflow_area_needs_reorganisation();
+    size_t get_overflow_home_page(size_t entry_pos);
+    ChainPosition find_in_overflow_chain(size_t start_index, uint64_t key);
+    void insert_at_chain_position(uint64_t &start_index, size_t entry_pos, uint64_t key, uint64_t value, const ChainPosition &position);
+    void insert_into_overflow_chain(uint64_t &start_index, size_t entry_pos, uint64_t key, uint64_t value);
+    std::vector<PageEntry> take_overflow_chain(size_t start_index, std::vector<size_t> &chain_slots);
+    void reclaim_overflow_slots(std::vector<size_t> &slots);
+    void reorganise_overflow_area();
+    void rebuild_free_space_map();
+    bool is_damaged(size_t counter);
+    size_t count_damaged_pages();
+    size_t get_overflow_chain_counter(size_t entry_pos);
+    void rebuild_overflow_chain_lengths();
+    void record_chain_walk(const std::vector<size_t> &visited_pages);
+    size_t find_index_position(uint64_t key);
+    IndexRange find_index_range(uint64_t key);
+    size_t find_leaf_position(uint64_t key);
+    bool sparse_index_holds_root();
+    void load_sparse_index();
+    size_t get_index_leaf_end(IndexArea &area);
+    std::vector<IndexEntry> read_index_leaf_level(IndexArea &area);
+    void write_index_area(IndexArea &area, const std::vector<IndexEntry> &leaf_entries, size_t first_page, SparseIndex &resident_index);
+    void fit_learned_index();
+    size_t get_bloom_filter(size_t entry_pos);
+    void rebuild_bloom_filters();
+    void save_sidecar_files();
+    void start_new_generation();
+    ReorganisedAreas build_reorganised_areas(IndexArea &source_index_area, MainArea &source_main_area, OverflowArea &source_overflow_area, uint64_t guardian_start, KeyValueSource *additions = nullptr);
+    void install_reorganised_areas(ReorganisedAreas &areas);
+    void start_background_reorganisation();
+    void finish_background_reorganisation();
+    bool buffer_write(uint64_t key, std::optional<uint64_t> value);
+
+    std::optional<uint64_t> search_wrapper(uint64_t key);
+
+    std::vector<std::optional<uint64_t>> multi_search_wrapper(std::span<const uint64_t> keys);
+
+    void print_wrapper();
+
+    void insert_wrapper(uint64_t key, uint64_t value);
+
+    void update_wrapper(uint64_t key, uint64_t value);
+
+    void remove_wrapper(uint64_t key);
+
+    bool conditional_write(uint64_t key, uint64_t value, WriteCondition condition, uint64_t expected = 0);
+
+    void reorganise_wrapper();
+
+    void reorganise_incremental_wrapper();
+
+    void print_stats_after_operation(OperationType operation);
+
+    void clear_counters();
+
+    Guardian guardian;
+
+    IndexArea index_area;
+    MainArea main_area;
+    OverflowArea overflow_area;
+
+    SparseIndex sparse_index;
+    IndexMode index_mode;
+
+    BloomFilters bloom_filters;
+    // Lookups of keys which are not in the database, and how many of them got past the filter
+    size_t absent_key_lookups = 0;
+    size_t bloom_filter_false_positives = 0;
+
+    // Overflow pages which still have a free slot
+    FreeSpaceMap free_space_map;
+    // Walks of overflow chains by lookups and inserts, and distinct pages they read
+    size_t overflow_chain_walks = 0;
+    size_t overflow_chain_walk_pages = 0;
+
+    // Overflow entries ever placed in the chains of every main area page, the last counter belongs to the guardian.
+    // Incremental reorganisation merges the pages whose chains got long.
+    std::vector<uint64_t> overflow_chain_lengths;
+    ReorganisationMode reorganisation_mode;
+
+    // Reorganisation running in the background and writes made meanwhile, empty value is a removal.
+    // The areas are only read until it is installed.
+    std::future<ReorganisedAreas> background_reorganisation;
+    std::map<uint64_t, std::optional<uint64_t>> delta_buffer;
+
+    // Declared after the areas, it refers to them
+    BufferPool buffer_pool;
+};
+
+// Throws if there is no engine for the blocking factor
+std::unique_ptr<DatabaseEngine> make_database_engine(size_t blocking_factor, const DatabaseOptions &options);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "key_value_source.hpp"
+
+// Sorts "key value" lines of any size by key. Runs of EXTERNAL_SORT_RUN_PAIRS pairs are sorted in memory,
+// all but the last are spilled to temporary files, then the runs are merged.
+// Pairs with equal keys come out in input order.
+class ExternalSort : public KeyValueSource
+{
+public:
+    explicit ExternalSort(std::istream &input);
+    ~ExternalSort() override;
+
+    ExternalSort(const ExternalSort &) = delete;
+    ExternalSort &operator=(const ExternalSort &) = delete;
+
+    ExternalSort(ExternalSort &&) = delete;
+    ExternalSort &operator=(ExternalSort &&) = delete;
+
+    bool next(uint64_t &key, uint64_t &value) override;
+
+private:
+    struct Head
+    {
+        uint64_t key;
+        uint64_t value;
+        size_t run;
+
+        // Smallest key on top of the queue, earlier run first on equal keys
+        bool operator>(const Head &other) const { return std::pair(key, run) > std::pair(other.key, other.run); }
+    };
+
+    void spill_run();
+    // Puts the next pair of the run into the queue, if it has one
+    void advance(size_t run);
+
+    std::vector<std::pair<uint64_t, uint64_t>> memory_run;
+    size_t memory_run_position = 0;
+    std::vector<std::string> run_paths;
+    std::vector<std::ifstream> runs;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <string>
+
+enum class FileBackendType
+{
+    FSTREAM,
+    POSIX
+};
+
+// Positioned reads and writes on a single file
+class FileBackend
+{
+public:
+    virtual ~FileBackend() = default;
+
+    // Returns false if the file is too small to read size bytes at offset
+    virtual bool read(void *data, size_t size, size_t offset) = 0;
+    // Grows the file if needed
+    virtual bool write(const void *data, size_t size, size_t offset) = 0;
+
+    virtual void flush() = 0;
+    virtual void close() = 0;
+    virtual void open(const std::string &path) = 0;
+
+    virtual size_t size() = 0;
+    virtual void resize(size_t new_size) = 0;
+
+    // File descriptor for mapping the file or asynchronous I/O, -1 if the backend doesn't have one
+    virtual int get_descriptor() const { return -1; }
+    // Data was written through the descriptor, bypassing the backend
+    virtual void note_external_write(size_t /*end_offset*/) {}
+};
+
+// Original implementation, seeks and checks the file size through iostreams on every access
+class FstreamFileBackend : public FileBackend
+{
+public:
+    FstreamFileBackend(const std::string &path, bool truncate);
+
+    bool read(void *data, size_t size, size_t offset) override;
+    bool write(const void *data, size_t size, size_t offset) override;
+
+    void flush() override;
+    void close() override;
+    void open(const std::string &path) override;
+
+    size_t size() override;
+    void resize(size_t new_size) override;
+
+private:
+    void reset_pointers();
+
+    std::fstream file;
+};
+
+// pread/pwrite on a file descriptor, file size is cached so every access is a single syscall
+class PosixFileBackend : public FileBackend
+{
+public:
+    // With direct_io the file is opened with O_DIRECT, falling back to the page cache if the file system refuses it
+    PosixFileBackend(const std::string &path, bool truncate, bool direct_io = false);
+    ~PosixFileBackend() override;
+
+    bool read(void *data, size_t size, size_t offset) override;
+    bool write(const void *data, size_t size, size_t offset) override;
+
+    void flush() override;
+    void close() override;
+    void open(const std::string &path) override;
+
+    size_t size() override;
+    void resize(size_t new_size) override;
+
+    int get_descriptor() const override { return fd; }
+    void note_external_write(size_t end_offset) override { file_size = std::max(file_size, end_offset); }
+
+private:
+    void open(const std::string &path, int flags);
+
+    int fd = -1;
+    size_t file_size = 0;
+    // Flags used when the file is reopened
+    int extra_flags = 0;
+};
+
+std::unique_ptr<FileBackend> make_file_backend(FileBackendType type, const std::string &path, bool truncate, bool direct_io = false);
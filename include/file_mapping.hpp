@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// Shared mapping of a whole file at a fixed address.
+// Address space for Settings::MAPPING_RESERVATION bytes is reserved up front, so growing
+// the mapping never moves it and pointers into it stay valid.
+class FileMapping
+{
+public:
+    FileMapping();
+    ~FileMapping();
+
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+
+    // Map first size bytes of the file, size must not exceed the file size
+    void map(int fd, size_t size);
+
+    // Write modified pages back to the file
+    void sync();
+
+    char *data() const { return base; }
+    size_t size() const { return mapped_size; }
+
+private:
+    char *base = nullptr;
+    size_t mapped_size = 0;
+};
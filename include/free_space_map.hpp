@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bitmap of overflow area pages which still have a free slot
+class FreeSpaceMap
+{
+public:
+    // Every page has room
+    void reset(size_t number_of_pages);
+    // Adds pages at the end, every one of them has room
+    void grow(size_t number_of_pages);
+
+    void set_has_room(size_t page_index, bool has_room);
+    bool has_room(size_t page_index) const;
+
+    // Page with room closest to the given one, -1 if every page is full
+    size_t find_nearest(size_t page_index) const;
+
+    size_t size() const { return number_of_pages; }
+
+    // Returns false if the file is missing, describes a different number of pages or was saved with a different generation
+    bool load(const std::string &path, size_t number_of_pages, uint64_t generation);
+    void save(const std::string &path, uint64_t generation) const;
+
+private:
+    size_t number_of_pages = 0;
+    std::vector<uint64_t> words;
+};
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+enum class IoEngineType
+{
+    IO_URING,
+    THREAD_POOL
+};
+
+// Asynchronous positioned reads and writes on file descriptors.
+// Requests are queued by submit_* and handed to the kernel in batches when somebody waits.
+class IoEngine
+{
+public:
+    using Ticket = uint64_t;
+
+    virtual ~IoEngine() = default;
+
+    virtual Ticket submit_read(int fd, void *data, size_t size, size_t offset) = 0;
+    virtual Ticket submit_write(int fd, const void *data, size_t size, size_t offset) = 0;
+
+    // Block until request is done, throws if it failed or transferred fewer bytes than asked
+    virtual void wait(Ticket ticket) = 0;
+    virtual void wait_all() = 0;
+
+    virtual IoEngineType get_type() const = 0;
+
+    // Engine of the calling thread, io_uring when the kernel allows it, thread pool otherwise.
+    // Requests have to be waited for on the thread which submitted them.
+    static IoEngine &get();
+};
+
+// Raw io_uring, without liburing
+class IoUringEngine : public IoEngine
+{
+public:
+    explicit IoUringEngine(unsigned entries);
+    ~IoUringEngine() override;
+
+    IoUringEngine(const IoUringEngine &) = delete;
+    IoUringEngine &operator=(const IoUringEngine &) = delete;
+
+    Ticket submit_read(int fd, void *data, size_t size, size_t offset) override;
+    Ticket submit_write(int fd, const void *data, size_t size, size_t offset) override;
+
+    void wait(Ticket ticket) override;
+    void wait_all() override;
+
+    IoEngineType get_type() const override { return IoEngineType::IO_URING; }
+
+private:
+    Ticket submit(uint8_t opcode, int fd, const void *data, size_t size, size_t offset);
+    // Hand queued requests to the kernel, optionally waiting for at least one completion
+    void enter(unsigned min_complete);
+    void reap_completions();
+    void check_result(Ticket ticket);
+
+    int ring_fd = -1;
+    unsigned sq_entries = 0;
+
+    void *sq_ring = nullptr;
+    void *cq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    void *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned *sq_head = nullptr;
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_array = nullptr;
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    void *cqes = nullptr;
+
+    unsigned to_submit = 0;
+    Ticket next_ticket = 1;
+
+    // Ticket -> expected number of bytes, until completion
+    std::unordered_map<Ticket, size_t> in_flight;
+    // Ticket -> result of the request, until somebody waits for it
+    std::unordered_map<Ticket, int64_t> completed;
+};
+
+// pread/pwrite on worker threads, used when io_uring is not available
+class ThreadPoolEngine : public IoEngine
+{
+public:
+    explicit ThreadPoolEngine(size_t number_of_threads);
+    ~ThreadPoolEngine() override;
+
+    Ticket submit_read(int fd, void *data, size_t size, size_t offset) override;
+    Ticket submit_write(int fd, const void *data, size_t size, size_t offset) override;
+
+    void wait(Ticket ticket) override;
+    void wait_all() override;
+
+    IoEngineType get_type() const override { return IoEngineType::THREAD_POOL; }
+
+private:
+    struct Request
+    {
+        Ticket ticket;
+        bool is_write;
+        int fd;
+        char *data;
+        size_t size;
+        size_t offset;
+    };
+
+    Ticket submit(Request request);
+    void worker();
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable request_available;
+    std::condition_variable request_done;
+    std::deque<Request> requests;
+    // Ticket -> true when it succeeded, until somebody waits for it
+    std::unordered_map<Ticket, bool> completed;
+    // Submitted but not finished yet
+    std::unordered_set<Ticket> pending;
+    Ticket next_ticket = 1;
+    bool stopping = false;
+};
+
+std::unique_ptr<IoEngine> make_io_engine(IoEngineType type);
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <utility>
+
+// Key value pairs handed out one at a time, sorted by key, e.g. to bulk load
+class KeyValueSource
+{
+public:
+    virtual ~KeyValueSource() = default;
+
+    // Returns false when there are no more pairs
+    virtual bool next(uint64_t &key, uint64_t &value) = 0;
+};
+
+// Pairs already in memory
+class SpanKeyValueSource : public KeyValueSource
+{
+public:
+    explicit SpanKeyValueSource(std::span<const std::pair<uint64_t, uint64_t>> pairs) : pairs(pairs) {}
+
+    bool next(uint64_t &key, uint64_t &value) override
+    {
+        if (position == pairs.size())
+        {
+            return false;
+        }
+        key = pairs[position].first;
+        value = pairs[position].second;
+        position++;
+        return true;
+    }
+
+private:
+    std::span<const std::pair<uint64_t, uint64_t>> pairs;
+    size_t position = 0;
+};
+
+
+// Pairs of a source for a range-based for loop. Iterators are single pass, they all advance the same source.
+class KeyValueRange
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::pair<uint64_t, uint64_t>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type *;
+        using reference = const value_type &;
+
+        iterator() = default;
+        explicit iterator(KeyValueSource *source) : source(source) { ++*this; }
+
+        reference operator*() const { return pair; }
+        pointer operator->() const { return &pair; }
+
+        iterator &operator++()
+        {
+            if (!source->next(pair.first, pair.second))
+            {
+                source = nullptr;
+            }
+            return *this;
+        }
+        void operator++(int) { ++*this; }
+
+        // Only the end iterator has no source
+        bool operator==(const iterator &other) const { return source == other.source; }
+
+    private:
+        KeyValueSource *source = nullptr;
+        value_type pair;
+    };
+
+    explicit KeyValueRange(std::unique_ptr<KeyValueSource> source) : source(std::move(source)) {}
+
+    iterator begin() { return iterator(source.get()); }
+    iterator end() { return iterator(); }
+
+private:
+    std::unique_ptr<KeyValueSource> source;
+};
\ No newline at end of file
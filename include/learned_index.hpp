@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class IndexMode
+{
+    BINARY_SEARCH,
+    LEARNED
+};
+
+// Piecewise linear model of the positions of sorted keys.
+// Segments are fitted so that the position of every key is predicted within max_error.
+class LearnedIndex
+{
+public:
+    LearnedIndex() = default;
+    LearnedIndex(const std::vector<uint64_t> &keys, size_t max_error);
+
+    // Positions [first, last) which hold the last key not greater than the given one, if the keys didn't change since fitting
+    std::pair<size_t, size_t> predict_window(uint64_t key) const;
+
+    size_t get_number_of_keys() const { return number_of_keys; }
+    size_t get_number_of_segments() const { return segments.size(); }
+
+    // Returns false if the file is missing or the model was fitted on a different number of keys
+    bool load(const std::string &path, size_t number_of_keys);
+    void save(const std::string &path) const;
+
+private:
+    struct Segment
+    {
+        uint64_t first_key;
+        uint64_t first_position;
+        double slope;
+    };
+
+    std::vector<Segment> segments;
+    uint64_t number_of_keys = 0;
+    uint64_t max_error = 0;
+};
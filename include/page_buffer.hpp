@@ -1,13 +1,25 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <concepts>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <fstream>
 #include <iostream>
-
+#include <vector>
+
+#include "buffer_pool.hpp"
+#include "debug.hpp"
+#include "file_mapping.hpp"
+#include "io_engine.hpp"
+#include "page_guard.hpp"
+#include "page_table.hpp"
+#include "replacement_policy.hpp"
 #include "scoped_file.hpp"
 #include "settings.hpp"
+#include "utils.hpp"
 
 template <typename T>
 concept HasIndex = requires(T t) {
@@ -24,81 +36,434 @@ concept HasNumberOfEntries = requires(T t) {
     { t.number_of_entries } -> std::convertible_to<size_t>;
 };
 
+template <typename T>
+concept HasBlockingFactor = requires(T t) {
+    { t.blocking_factor } -> std::convertible_to<size_t>;
+};
+
+template <typename T>
+concept HasStaticBlockingFactor = requires {
+    { T::BLOCKING_FACTOR } -> std::convertible_to<size_t>;
+};
+
+enum class StorageMode
+{
+    // Pages are copied into frames of the buffer
+    BUFFERED,
+    // Whole file is memory mapped and pages are used in place, needs the POSIX file backend
+    MAPPED
+};
+
+// How a PageBuffer is set up, defaults come from Settings
+struct BufferOptions
+{
+    StorageMode storage_mode = StorageMode::BUFFERED;
+    size_t number_of_frames = Settings::DEFAULT_PAGE_BUFFER_SIZE;
+    ReplacementPolicyType replacement_policy = Settings::DEFAULT_REPLACEMENT_POLICY;
+    FileBackendType file_backend = Settings::DEFAULT_FILE_BACKEND;
+    // Bypass the kernel page cache, header and pages are padded to whole disk blocks then.
+    // Files have to be opened with the same setting they were created with.
+    bool direct_io = false;
+    // Another buffer owns the file, pages and header are only read and nothing is written back
+    bool read_only = false;
+};
+
 template <typename Page, typename Header>
-    requires HasIndex<Page> && HasNumberOfPages<Header> && HasNumberOfEntries<Page>
-class PageBuffer
+    requires HasIndex<Page> && HasNumberOfPages<Header> && HasNumberOfEntries<Page> && HasBlockingFactor<Header> && HasStaticBlockingFactor<Page>
+class PageBuffer : public ManagedBuffer
 {
 public:
-    using PagePtr = std::shared_ptr<Page>;
+    using PagePtr = PageGuard<Page>;
+    using ConstPagePtr = PageGuard<const Page>;
 
 private:
-    size_t evict_page()
+    struct AlignedFree
+    {
+        void operator()(std::byte *data) const { std::free(data); }
+    };
+    using AlignedBlock = std::unique_ptr<std::byte[], AlignedFree>;
+
+    static AlignedBlock allocate_aligned(size_t alignment, size_t size)
+    {
+        auto *data = static_cast<std::byte *>(std::aligned_alloc(alignment, size));
+        if (!data)
+        {
+            throw std::bad_alloc();
+        }
+        // Padding after the page gets written to disk too, keep it deterministic
+        std::memset(data, 0, size);
+        return AlignedBlock(data);
+    }
+
+    // Frames live in one arena. Frames are cache line aligned, so neighbouring pages don't share lines,
+    // with direct I/O every frame is a whole disk block.
+    size_t get_frame_alignment() const
+    {
+        return options.direct_io ? Settings::DIRECT_IO_BLOCK_SIZE : Settings::CACHE_LINE_SIZE;
+    }
+
+    Page &frame_page(size_t frame)
+    {
+        return *std::launder(reinterpret_cast<Page *>(frames.get() + frame * frame_stride));
+    }
+
+    // Where the page is stored in the file
+    size_t get_page_offset(size_t index) const
+    {
+        return header_block_size + index * page_slot_size;
+    }
+
+    size_t evict_page(size_t incoming_page_index)
     {
-        for (size_t i = 0; i < pages.size(); ++i)
+        // Page can be evicted only if it is not pinned
+        auto victim = replacement_policy->choose_victim(incoming_page_index, [this](size_t frame)
+                                                        { return descriptors[frame].page_index != -1ULL && descriptors[frame].pin_count == 0; });
+        if (!victim)
         {
-            if (pages[i] && pages[i].use_count() == 1)
+            throw std::runtime_error("No page to evict");
+        }
+
+        auto &descriptor = descriptors[*victim];
+        complete_io(*victim);
+
+        // Save this page to disk, clean pages already match the disk
+        if (descriptor.dirty)
+        {
+            write_page_to_disk(frame_page(*victim));
+            descriptor.dirty = false;
+        }
+
+        page_table.erase(descriptor.page_index);
+        replacement_policy->on_evict(*victim, descriptor.page_index);
+        descriptor.page_index = -1ULL;
+        return *victim;
+    }
+
+    // Returns free frame, evicting a page if there is none
+    size_t get_free_frame(size_t incoming_page_index)
+    {
+        if (page_table.size() < number_of_frames)
+        {
+            for (size_t i = 0; i < number_of_frames; ++i)
             {
-                // Save this page to disk
-                write_page_to_disk(*pages[i]);
-                return i;
+                if (descriptors[i].page_index == -1ULL)
+                {
+                    return i;
+                }
             }
         }
+        return evict_page(incoming_page_index);
+    }
+
+    void place_page(size_t frame, size_t page_index, bool is_dirty)
+    {
+        descriptors[frame].page_index = page_index;
+        descriptors[frame].dirty = is_dirty;
+        page_table.insert(page_index, frame);
+        replacement_policy->on_load(frame, page_index);
+    }
+
+    // Returns frame holding the page, loading it from disk if needed
+    size_t get_frame(size_t index)
+    {
+        if (auto frame = page_table.find(index))
+        {
+            hit_counter++;
+            total_hit_counter++;
+            all_hit_counter++;
+            replacement_policy->on_hit(*frame);
+            // Page may still be on its way from or to disk
+            complete_io(*frame);
+            return *frame;
+        }
 
-        throw std::runtime_error("No page to evict");
+        miss_counter++;
+        total_miss_counter++;
+        all_miss_counter++;
+        size_t frame = get_free_frame(index);
+        read_page_from_disk(index, frame_page(frame));
+        place_page(frame, index, false);
+        return frame;
     }
 
-    Page get_page_from_disk(size_t index)
+    void check_writable() const
+    {
+        if (options.read_only)
+        {
+            throw std::runtime_error("Buffer of " + file_path + " is read-only");
+        }
+    }
+
+    // Asynchronous I/O goes straight to the file descriptor, mapped areas don't use frames at all
+    bool can_use_async_io() const
+    {
+        return !mapping && file.get_descriptor() != -1;
+    }
+
+    void complete_io(size_t frame)
+    {
+        if (descriptors[frame].io_ticket != 0)
+        {
+            IoEngine::get().wait(std::exchange(descriptors[frame].io_ticket, 0));
+        }
+    }
+
+    void complete_all_io()
+    {
+        for (size_t i = 0; i < number_of_frames; ++i)
+        {
+            complete_io(i);
+        }
+    }
+
+    // Start writing page back without waiting, frame stays in the buffer as a clean page
+    void submit_page_write(size_t frame)
+    {
+        complete_io(frame);
+
+        const Page &page = frame_page(frame);
+        size_t offset = get_page_offset(page.index);
+        write_counter++;
+        all_write_counter++;
+        descriptors[frame].io_ticket = IoEngine::get().submit_write(file.get_descriptor(), &page, page_slot_size, offset);
+        descriptors[frame].dirty = false;
+        file.note_external_write(offset + page_slot_size);
+    }
+
+    void allocate_frames(size_t count)
+    {
+        number_of_frames = count;
+        frames = allocate_aligned(get_frame_alignment(), count * frame_stride);
+        for (size_t i = 0; i < count; ++i)
+        {
+            new (frames.get() + i * frame_stride) Page();
+        }
+        descriptors = std::make_unique<FrameDescriptor[]>(count);
+        page_table = PageTable(count);
+        replacement_policy = make_replacement_policy(options.replacement_policy, count);
+    }
+
+    Page *get_mapped_page(size_t index)
+    {
+        if (index >= header.number_of_pages)
+        {
+            throw std::runtime_error("Failed to read page from disk");
+        }
+        return reinterpret_cast<Page *>(mapping->data() + get_page_offset(index));
+    }
+
+    // Map the file far enough to cover number_of_pages pages, growing the file when needed
+    void ensure_mapped(size_t number_of_pages)
+    {
+        // Mapping grows in large steps, dirty flags have to cover every page either way
+        mapped_dirty.resize(std::max(mapped_dirty.size(), number_of_pages), false);
+        size_t needed_size = get_page_offset(number_of_pages);
+        if (mapping->size() >= needed_size)
+        {
+            return;
+        }
+        if (file.size() < needed_size)
+        {
+            size_t steps = (needed_size + Settings::MAPPING_GROWTH - 1) / Settings::MAPPING_GROWTH;
+            file.resize(steps * Settings::MAPPING_GROWTH);
+        }
+        mapping->map(file.get_descriptor(), file.size());
+    }
+
+    void read_page_from_disk(size_t index, Page &page)
     {
         read_counter++;
         all_read_counter++;
-        Page page;
-        if (!file.read(reinterpret_cast<char *>(&page), sizeof(Page), sizeof(Header) + index * sizeof(Page)))
+        if (!file.read(reinterpret_cast<char *>(&page), page_slot_size, get_page_offset(index)))
         {
             throw std::runtime_error("Failed to read page from disk");
         }
-        return page;
+    }
+
+    bool read_header_from_disk()
+    {
+        if (!header_block)
+        {
+            return file.read(reinterpret_cast<char *>(&header), sizeof(Header), 0);
+        }
+        if (!file.read(header_block.get(), header_block_size, 0))
+        {
+            return false;
+        }
+        std::memcpy(&header, header_block.get(), sizeof(Header));
+        return true;
+    }
+
+    void write_header_to_disk()
+    {
+        if (!header_block)
+        {
+            file.write(reinterpret_cast<char *>(&header), sizeof(Header), 0);
+            return;
+        }
+        std::memcpy(header_block.get(), &header, sizeof(Header));
+        file.write(header_block.get(), header_block_size, 0);
     }
 
     void write_page_to_disk(const Page &page)
     {
         write_counter++;
         all_write_counter++;
-        file.write(reinterpret_cast<const char *>(&page), sizeof(Page), sizeof(Header) + page.index * sizeof(Page));
+        file.write(reinterpret_cast<const char *>(&page), page_slot_size, get_page_offset(page.index));
+    }
+
+    Page &extent_page(size_t extent, size_t position)
+    {
+        return *std::launder(reinterpret_cast<Page *>(extents[extent].data.get() + position * page_slot_size));
+    }
+
+    // Whole extent goes to disk with one request, asynchronously when possible
+    void write_extent(size_t extent)
+    {
+        auto &current = extents[extent];
+        if (current.number_of_pages == 0)
+        {
+            return;
+        }
+
+        size_t offset = get_page_offset(current.first_page);
+        size_t size = current.number_of_pages * page_slot_size;
+        write_counter++;
+        all_write_counter++;
+        if (file.get_descriptor() != -1)
+        {
+            current.io_ticket = IoEngine::get().submit_write(file.get_descriptor(), current.data.get(), size, offset);
+            file.note_external_write(offset + size);
+        }
+        else
+        {
+            file.write(current.data.get(), size, offset);
+        }
+    }
+
+    void complete_extent_io(size_t extent)
+    {
+        if (extents[extent].io_ticket != 0)
+        {
+            IoEngine::get().wait(std::exchange(extents[extent].io_ticket, 0));
+        }
     }
 
     Header header;
-    std::array<PagePtr, Settings::DEFAULT_PAGE_BUFFER_SIZE> pages;
+    // Page data and bookkeeping live in separate preallocated arrays
+    size_t number_of_frames = 0;
+    AlignedBlock frames;
+    std::unique_ptr<FrameDescriptor[]> descriptors;
+    PageTable page_table;
+    // Only used in StorageMode::MAPPED, frames stay unused then
+    std::unique_ptr<FileMapping> mapping;
+    std::vector<bool> mapped_dirty;
+    BufferOptions options;
+    std::unique_ptr<ReplacementPolicy> replacement_policy;
     ScopedFile file;
     std::string file_path;
 
-    size_t read_counter;
-    size_t write_counter;
+    // Layout of the file, disk blocks with direct I/O, tightly packed otherwise
+    size_t header_block_size = sizeof(Header);
+    size_t page_slot_size = 0;
+    size_t frame_stride = 0;
+    // Header goes through this aligned copy with direct I/O
+    AlignedBlock header_block;
 
-    inline static size_t all_read_counter;
-    inline static size_t all_write_counter;
+    // Pages appended straight to the file, one extent is filled while the other is being written
+    struct Extent
+    {
+        AlignedBlock data;
+        size_t first_page = 0;
+        size_t number_of_pages = 0;
+        uint64_t io_ticket = 0;
+    };
+    std::array<Extent, 2> extents;
+    size_t current_extent = 0;
+    // 0 when pages go through the frames
+    size_t pages_per_extent = 0;
+
+    size_t read_counter = 0;
+    size_t write_counter = 0;
+    size_t hit_counter = 0;
+    size_t miss_counter = 0;
+
+    size_t total_hit_counter = 0;
+    size_t total_miss_counter = 0;
+
+    // Shared by buffers of background reorganisation
+    inline static std::atomic<size_t> all_read_counter;
+    inline static std::atomic<size_t> all_write_counter;
+    inline static std::atomic<size_t> all_hit_counter;
+    inline static std::atomic<size_t> all_miss_counter;
 
 public:
-    PageBuffer(std::string_view file_path, bool truncate = false) : file(file_path, truncate), file_path(file_path)
+    PageBuffer(std::string_view file_path, bool truncate = false, const BufferOptions &options = {})
+        : options(options), file(file_path, truncate, options.file_backend, options.direct_io), file_path(file_path)
     {
-        pages.fill(nullptr);
+        if (options.direct_io)
+        {
+            header_block_size = align_up(sizeof(Header), Settings::DIRECT_IO_BLOCK_SIZE);
+            header_block = allocate_aligned(Settings::DIRECT_IO_BLOCK_SIZE, header_block_size);
+        }
 
         // Try to read header from disk
         // If header is not found, create a new one along with a new root page
-        if (!file.read(reinterpret_cast<char *>(&header), sizeof(Header), 0))
+        bool is_new_file = !read_header_from_disk();
+        if (is_new_file && options.read_only)
+        {
+            throw std::runtime_error("Cannot open missing " + this->file_path + " read-only");
+        }
+        if (is_new_file)
         {
-            // Header not found, create a new one
             header = Header();
-            pages[0] = create_page();
+            header.blocking_factor = Page::BLOCKING_FACTOR;
+        }
+        if (header.blocking_factor != Page::BLOCKING_FACTOR)
+        {
+            throw std::runtime_error("Blocking factor of " + this->file_path + " is " + std::to_string(header.blocking_factor) +
+                                     ", expected " + std::to_string(Page::BLOCKING_FACTOR));
+        }
+
+        page_slot_size = sizeof(Page);
+        frame_stride = align_up(page_slot_size, Settings::CACHE_LINE_SIZE);
+        if (options.direct_io)
+        {
+            page_slot_size = align_up(page_slot_size, Settings::DIRECT_IO_BLOCK_SIZE);
+            frame_stride = page_slot_size;
+        }
+        allocate_frames(options.number_of_frames);
+
+        if (options.storage_mode == StorageMode::MAPPED)
+        {
+            if (file.get_descriptor() == -1)
+            {
+                throw std::runtime_error("Memory mapped storage needs the POSIX file backend");
+            }
+            mapping = std::make_unique<FileMapping>();
+        }
+
+        if (is_new_file)
+        {
+            create_page();
+        }
+        else if (mapping)
+        {
+            ensure_mapped(header.number_of_pages);
         }
         else
         {
             // Load root page from disk
-            pages[0] = std::make_shared<Page>(get_page_from_disk(0));
+            get_frame(0);
         }
     }
 
     ~PageBuffer()
     {
+        if (size_t pinned = get_pinned_frame_count())
+        {
+            DEBUG_CERR << "PageBuffer " << file_path << ": " << pinned << " frames still pinned on destruction" << std::endl;
+        }
         flush();
     }
 
@@ -114,37 +479,136 @@ public:
             return *this;
         }
 
+        // Guards point into the frames which are about to change owner
+        if (get_pinned_frame_count() > 0 || other.get_pinned_frame_count() > 0)
+        {
+            throw std::runtime_error("Cannot replace buffer with pinned pages");
+        }
+
+        complete_all_io();
+        other.complete_all_io();
+        finish_appending();
+        other.finish_appending();
+
+        size_t frames_to_keep = number_of_frames;
+
         // Swap members
         std::swap(header, other.header);
-        std::swap(pages, other.pages);
+        std::swap(number_of_frames, other.number_of_frames);
+        std::swap(frames, other.frames);
+        std::swap(descriptors, other.descriptors);
+        std::swap(page_table, other.page_table);
+        std::swap(replacement_policy, other.replacement_policy);
+        // Mapping follows the file, it stays valid through the rename below
+        std::swap(mapping, other.mapping);
+        std::swap(mapped_dirty, other.mapped_dirty);
 
         // Close handles
         other.file.close();
         file.close();
 
-        std::remove(file_path.c_str());
+        // Rename replaces the file atomically, the path always names a complete file
         std::rename(other.file_path.c_str(), file_path.c_str());
 
         // Open file with new path
         file.open(file_path);
 
         // Clear other's in-memory state but keep its file path
-        other.pages.fill(nullptr);
+        for (size_t i = 0; i < other.number_of_frames; ++i)
+        {
+            other.descriptors[i] = FrameDescriptor{};
+        }
+        other.page_table.clear();
+        other.replacement_policy->reset();
+        other.mapped_dirty.clear();
         other.header = {};
 
+        // Keep the number of frames assigned to this buffer
+        set_number_of_frames(frames_to_keep);
+
         return *this;
     }
 
     static size_t get_all_read_count() { return all_read_counter; }
     static size_t get_all_write_count() { return all_write_counter; }
 
+    static size_t get_all_hit_count() { return all_hit_counter; }
+    static size_t get_all_miss_count() { return all_miss_counter; }
+
     size_t get_read_count() { return read_counter; }
     size_t get_write_count() { return write_counter; }
+    // Reads made on behalf of this buffer by another one over the same file
+    void add_read_count(size_t count) { read_counter += count; }
+    size_t get_hit_count() { return hit_counter; }
+    size_t get_miss_count() { return miss_counter; }
+
+    size_t get_total_hit_count() const override { return total_hit_counter; }
+    size_t get_total_miss_count() const override { return total_miss_counter; }
+
+    size_t get_number_of_frames() const override { return number_of_frames; }
+
+    // Options for a buffer set up the same way as this one
+    BufferOptions get_options() const
+    {
+        BufferOptions current = options;
+        current.number_of_frames = number_of_frames;
+        return current;
+    }
+    size_t get_frame_size() const override { return frame_stride + sizeof(FrameDescriptor); }
+    size_t get_number_of_pages() const override { return header.number_of_pages; }
+
+    size_t get_pinned_frame_count() const override
+    {
+        size_t pinned = 0;
+        for (size_t i = 0; i < number_of_frames; ++i)
+        {
+            pinned += descriptors[i].pin_count > 0;
+        }
+        return pinned;
+    }
+
+    // Grow or shrink the buffer, pages which don't fit are written back if needed.
+    // Frames are reallocated, so no page may be pinned.
+    void set_number_of_frames(size_t count) override
+    {
+        if (count == 0)
+        {
+            throw std::runtime_error("Buffer needs at least one frame");
+        }
+        if (get_pinned_frame_count() > 0)
+        {
+            throw std::runtime_error("Cannot resize buffer with pinned pages");
+        }
+        complete_all_io();
+
+        while (page_table.size() > count)
+        {
+            evict_page(-1ULL);
+        }
+
+        auto old_frames = std::move(frames);
+        auto old_descriptors = std::move(descriptors);
+        size_t old_number_of_frames = number_of_frames;
+
+        allocate_frames(count);
+        size_t frame = 0;
+        for (size_t i = 0; i < old_number_of_frames; ++i)
+        {
+            if (old_descriptors[i].page_index != -1ULL)
+            {
+                std::memcpy(frames.get() + frame * frame_stride, old_frames.get() + i * frame_stride, page_slot_size);
+                place_page(frame, old_descriptors[i].page_index, old_descriptors[i].dirty);
+                frame++;
+            }
+        }
+    }
 
     void clear_counters()
     {
         read_counter = 0;
         write_counter = 0;
+        hit_counter = 0;
+        miss_counter = 0;
     }
 
     Header &get_header()
@@ -152,73 +616,394 @@ public:
         return header;
     }
 
-    PagePtr get_page(size_t index)
+    // Read-only access, page won't be written back because of it
+    ConstPagePtr get_page(size_t index)
+    {
+        if (mapping)
+        {
+            hit_counter++;
+            total_hit_counter++;
+            all_hit_counter++;
+            return ConstPagePtr(nullptr, get_mapped_page(index));
+        }
+
+        size_t frame = get_frame(index);
+        return ConstPagePtr(&descriptors[frame], &frame_page(frame));
+    }
+
+    // Mutable access, page is marked dirty and written back on eviction or flush
+    PagePtr get_page_for_write(size_t index)
+    {
+        check_writable();
+        if (mapping)
+        {
+            hit_counter++;
+            total_hit_counter++;
+            all_hit_counter++;
+            mapped_dirty[index] = true;
+            return PagePtr(nullptr, get_mapped_page(index));
+        }
+
+        size_t frame = get_frame(index);
+        descriptors[frame].dirty = true;
+        return PagePtr(&descriptors[frame], &frame_page(frame));
+    }
+
+    // Mutable access to a page the caller rewrites as a whole, it isn't read from disk when it's not in the buffer
+    PagePtr overwrite_page(size_t index)
     {
-        // If page is in buffer, return it
-        size_t index_in_buffer = -1;
-        for (size_t i = 0; i < pages.size(); ++i)
+        check_writable();
+        if (mapping || page_table.find(index))
+        {
+            return get_page_for_write(index);
+        }
+
+        size_t frame = get_free_frame(index);
+        new (&frame_page(frame)) Page();
+        frame_page(frame).index = index;
+        place_page(frame, index, true);
+        return PagePtr(&descriptors[frame], &frame_page(frame));
+    }
+
+    // Start reading up to count pages from first on, so later get_page calls find them in the buffer.
+    // Takes at most half of the frames, so pages already in use aren't pushed out by the read ahead.
+    void prefetch(size_t first, size_t count)
+    {
+        if (!can_use_async_io())
+        {
+            return;
+        }
+
+        count = std::min(count, number_of_frames / 2);
+        size_t last = std::min(first + count, header.number_of_pages);
+        for (size_t index = first; index < last; ++index)
+        {
+            size_t offset = get_page_offset(index);
+            if (page_table.find(index) || file.size() < offset + page_slot_size)
+            {
+                continue;
+            }
+
+            size_t frame = get_free_frame(index);
+            read_counter++;
+            all_read_counter++;
+            descriptors[frame].io_ticket = IoEngine::get().submit_read(file.get_descriptor(), &frame_page(frame), page_slot_size, offset);
+            place_page(frame, index, false);
+        }
+    }
+
+    // Start writing a page the caller is done with, instead of waiting for its eviction or flush
+    void write_behind(size_t index)
+    {
+        if (!can_use_async_io())
+        {
+            return;
+        }
+
+        auto frame = page_table.find(index);
+        if (frame && descriptors[*frame].dirty && descriptors[*frame].pin_count == 0)
+        {
+            submit_page_write(*frame);
+        }
+    }
+
+    // Reads pages for a range scan into slots of its own, the frames and the replacement policy never see them,
+    // so a long scan doesn't push out the pages other operations use. Pages in the frames are copied from there,
+    // the rest is read from the file, asynchronously when prefetched. The area mustn't change while it is used.
+    class ScanReader
+    {
+    public:
+        ScanReader(PageBuffer &buffer, size_t number_of_slots) : buffer(buffer), slots(std::max<size_t>(number_of_slots, 2))
+        {
+            // Appended pages have to be in the file before they can be read past the frames
+            buffer.finish_appending();
+            if (!buffer.mapping)
+            {
+                data = allocate_aligned(buffer.get_frame_alignment(), slots.size() * buffer.frame_stride);
+            }
+        }
+
+        ~ScanReader()
+        {
+            // Reads still in flight write into the slots
+            for (auto &slot : slots)
+            {
+                if (slot.io_ticket != 0)
+                {
+                    try
+                    {
+                        IoEngine::get().wait(std::exchange(slot.io_ticket, 0));
+                    }
+                    catch (const std::exception &)
+                    {
+                        // Page was never used, nothing to report
+                    }
+                }
+            }
+        }
+
+        ScanReader(const ScanReader &) = delete;
+        ScanReader &operator=(const ScanReader &) = delete;
+
+        // Start reading the page unless a slot already holds it. Slot used the longest time ago is taken,
+        // the page returned by the last get keeps its slot.
+        void prefetch(size_t index)
+        {
+            if (buffer.mapping || index >= buffer.header.number_of_pages || find_slot(index) != -1ULL)
+            {
+                return;
+            }
+            load(choose_slot(), index, buffer.can_use_async_io());
+        }
+
+        // Stays valid until the next get
+        const Page &get(size_t index)
+        {
+            if (buffer.mapping)
+            {
+                return *buffer.get_mapped_page(index);
+            }
+
+            size_t slot = find_slot(index);
+            if (slot == -1ULL)
+            {
+                slot = choose_slot();
+                load(slot, index, false);
+            }
+            if (slots[slot].io_ticket != 0)
+            {
+                IoEngine::get().wait(std::exchange(slots[slot].io_ticket, 0));
+            }
+            slots[slot].last_use = ++clock;
+            last_returned = slot;
+            return slot_page(slot);
+        }
+
+    private:
+        struct Slot
         {
-            if (pages[i] && pages[i]->index == index)
+            size_t page_index = -1ULL;
+            IoEngine::Ticket io_ticket = 0;
+            size_t last_use = 0;
+        };
+
+        Page &slot_page(size_t slot)
+        {
+            return *std::launder(reinterpret_cast<Page *>(data.get() + slot * buffer.frame_stride));
+        }
+
+        size_t find_slot(size_t index) const
+        {
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                if (slots[i].page_index == index)
+                {
+                    return i;
+                }
+            }
+            return -1ULL;
+        }
+
+        size_t choose_slot() const
+        {
+            size_t victim = last_returned == 0 ? 1 : 0;
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                if (i != last_returned && slots[i].last_use < slots[victim].last_use)
+                {
+                    victim = i;
+                }
+            }
+            return victim;
+        }
+
+        void load(size_t slot, size_t index, bool async)
+        {
+            auto &current = slots[slot];
+            if (current.io_ticket != 0)
+            {
+                IoEngine::get().wait(std::exchange(current.io_ticket, 0));
+            }
+            // Slot is reused if the read fails
+            current.page_index = -1ULL;
+            current.last_use = ++clock;
+
+            // Frame may hold a newer version than the file
+            if (auto frame = buffer.page_table.find(index))
             {
-                return pages[i];
+                buffer.complete_io(*frame);
+                std::memcpy(static_cast<void *>(&slot_page(slot)), &buffer.frame_page(*frame), sizeof(Page));
             }
-            if (index_in_buffer == -1 && !pages[i])
+            else if (async)
             {
-                index_in_buffer = i;
+                buffer.read_counter++;
+                all_read_counter++;
+                current.io_ticket = IoEngine::get().submit_read(buffer.file.get_descriptor(), &slot_page(slot), buffer.page_slot_size, buffer.get_page_offset(index));
             }
+            else
+            {
+                buffer.read_page_from_disk(index, slot_page(slot));
+            }
+            current.page_index = index;
         }
 
-        // If page is not in buffer
+        PageBuffer &buffer;
+        AlignedBlock data;
+        std::vector<Slot> slots;
+        size_t clock = 0;
+        size_t last_returned = -1ULL;
+    };
+
+    // Drops every page and starts the area over. Pages made by create_page are then filled in place in
+    // extents of REORGANISATION_EXTENT_SIZE, written sequentially without going through the frames.
+    // Appended pages can be read once finish_appending wrote them. Mapped areas have no frames to bypass.
+    void start_appending()
+    {
+        check_writable();
+        if (get_pinned_frame_count() > 0)
+        {
+            throw std::runtime_error("Cannot start appending with pinned pages");
+        }
+        complete_all_io();
 
-        // Get page from disk
-        auto page = get_page_from_disk(index);
+        for (size_t i = 0; i < number_of_frames; ++i)
+        {
+            descriptors[i] = FrameDescriptor{};
+        }
+        page_table.clear();
+        replacement_policy->reset();
+        header.number_of_pages = 0;
+        if (mapping)
+        {
+            mapped_dirty.clear();
+            return;
+        }
 
-        if (index_in_buffer != -1)
+        pages_per_extent = std::max<size_t>(1, (Settings::REORGANISATION_EXTENT_SIZE + page_slot_size - 1) / page_slot_size);
+        for (auto &extent : extents)
         {
-            pages[index_in_buffer] = std::make_shared<Page>(page);
-            return pages[index_in_buffer];
+            extent.data = allocate_aligned(get_frame_alignment(), align_up(pages_per_extent * page_slot_size, get_frame_alignment()));
+            extent.number_of_pages = 0;
         }
+        current_extent = 0;
+    }
 
-        // If there is no space in buffer, evict a page
-        if (index_in_buffer == -1)
+    // Writes the last extent and waits for every one, pages go through the frames again
+    void finish_appending()
+    {
+        if (pages_per_extent == 0)
         {
-            size_t evicted_page_index = evict_page();
-            pages[evicted_page_index] = std::make_shared<Page>(page);
-            return pages[evicted_page_index];
+            return;
         }
 
-        throw std::runtime_error("No space to load a new page");
+        write_extent(current_extent);
+        for (size_t i = 0; i < extents.size(); ++i)
+        {
+            complete_extent_io(i);
+            extents[i].data.reset();
+        }
+        pages_per_extent = 0;
     }
 
     PagePtr create_page()
     {
-        auto page = std::make_shared<Page>();
-        page->index = header.number_of_pages;
-        header.number_of_pages++;
-        for (size_t i = 0; i < pages.size(); ++i)
+        check_writable();
+        size_t index = header.number_of_pages;
+
+        if (pages_per_extent > 0)
         {
-            if (!pages[i])
+            if (extents[current_extent].number_of_pages == pages_per_extent)
             {
-                pages[i] = page;
-                return page;
+                write_extent(current_extent);
+                current_extent ^= 1;
+                // Other extent may still be on its way to disk
+                complete_extent_io(current_extent);
+                extents[current_extent].number_of_pages = 0;
             }
+
+            auto &extent = extents[current_extent];
+            if (extent.number_of_pages == 0)
+            {
+                extent.first_page = index;
+            }
+            header.number_of_pages++;
+
+            Page *page = new (&extent_page(current_extent, extent.number_of_pages++)) Page();
+            page->index = index;
+            return PagePtr(nullptr, page);
         }
 
-        // No space to create a new page, evict a page
-        size_t evicted_page_index = evict_page();
-        pages[evicted_page_index] = page;
-        return page;
+        if (mapping)
+        {
+            ensure_mapped(index + 1);
+            header.number_of_pages++;
+            mapped_dirty[index] = true;
+
+            Page *page = new (get_mapped_page(index)) Page();
+            page->index = index;
+            return PagePtr(nullptr, page);
+        }
+
+        size_t frame = get_free_frame(index);
+        header.number_of_pages++;
+
+        new (&frame_page(frame)) Page();
+        frame_page(frame).index = index;
+        place_page(frame, index, true);
+        return PagePtr(&descriptors[frame], &frame_page(frame));
+    }
+
+    // Writes only the header, pages stay in the buffer as they are
+    void flush_header()
+    {
+        check_writable();
+        write_header_to_disk();
+        file.flush();
     }
 
     void flush()
     {
-        file.write(reinterpret_cast<char *>(&header), sizeof(Header), 0);
-        for (size_t i = 0; i < pages.size(); ++i)
+        // Nothing can be dirty, only reads started ahead are waited for
+        if (options.read_only)
+        {
+            complete_all_io();
+            return;
+        }
+
+        finish_appending();
+        write_header_to_disk();
+        // All dirty pages are submitted as one batch, then waited for together
+        bool async = can_use_async_io();
+        for (size_t i = 0; i < number_of_frames; ++i)
+        {
+            if (descriptors[i].page_index != -1ULL && descriptors[i].dirty)
+            {
+                if (async)
+                {
+                    submit_page_write(i);
+                }
+                else
+                {
+                    write_page_to_disk(frame_page(i));
+                    descriptors[i].dirty = false;
+                }
+            }
+        }
+        complete_all_io();
+
+        if (mapping)
         {
-            if (pages[i])
+            // Pages were modified in place, count them as written and let the kernel write them back
+            for (size_t i = 0; i < mapped_dirty.size(); ++i)
             {
-                write_page_to_disk(*pages[i]);
+                if (mapped_dirty[i])
+                {
+                    write_counter++;
+                    all_write_counter++;
+                    mapped_dirty[i] = false;
+                }
             }
+            mapping->sync();
         }
         file.flush();
     }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Bookkeeping of a single buffer frame, kept apart from the page data
+struct FrameDescriptor
+{
+    size_t page_index = -1ULL; // -1 when frame is free
+    size_t pin_count = 0;
+    bool dirty = false;
+    // Asynchronous read or write of the frame still in progress, 0 when there is none
+    uint64_t io_ticket = 0;
+};
+
+// Keeps page pinned in its frame for as long as the guard lives.
+// Guards can only be moved, copying would silently pin the frame again.
+// Pages of memory mapped areas have no frame, their guards don't pin anything.
+template <typename Page>
+class PageGuard
+{
+public:
+    PageGuard() = default;
+
+    PageGuard(FrameDescriptor *descriptor, Page *page) : descriptor(descriptor), page(page)
+    {
+        if (descriptor)
+        {
+            descriptor->pin_count++;
+        }
+    }
+
+    ~PageGuard()
+    {
+        release();
+    }
+
+    PageGuard(const PageGuard &) = delete;
+    PageGuard &operator=(const PageGuard &) = delete;
+
+    PageGuard(PageGuard &&other) noexcept
+        : descriptor(std::exchange(other.descriptor, nullptr)), page(std::exchange(other.page, nullptr))
+    {
+    }
+
+    PageGuard &operator=(PageGuard &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            descriptor = std::exchange(other.descriptor, nullptr);
+            page = std::exchange(other.page, nullptr);
+        }
+        return *this;
+    }
+
+    // Unpin the page before the guard goes out of scope
+    void release()
+    {
+        if (descriptor)
+        {
+            descriptor->pin_count--;
+            descriptor = nullptr;
+        }
+        page = nullptr;
+    }
+
+    Page *operator->() const { return page; }
+    Page &operator*() const { return *page; }
+    Page *get() const { return page; }
+
+    explicit operator bool() const { return page != nullptr; }
+
+private:
+    FrameDescriptor *descriptor = nullptr;
+    Page *page = nullptr;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+enum class PageSearchKernel
+{
+    SCALAR,
+    SSE42,
+    AVX2
+};
+
+// Index of the first of count keys greater than key, count if there is none.
+// Uses the widest SIMD kernel the CPU supports, chosen once at startup.
+size_t find_first_greater(const uint64_t *keys, size_t count, uint64_t key);
+
+// Kernel chosen at startup, reported by print_stats
+PageSearchKernel get_page_search_kernel();
+
+std::ostream &operator<<(std::ostream &os, PageSearchKernel kernel);
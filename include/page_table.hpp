@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Page index -> frame map with fixed capacity.
+// Open addressing with linear probing, so lookups and inserts never allocate.
+class PageTable
+{
+public:
+    explicit PageTable(size_t number_of_frames = 0)
+    {
+        // Keep load factor at most 1/2
+        size_t capacity = 2;
+        while (capacity < 2 * number_of_frames)
+        {
+            capacity *= 2;
+        }
+        slots.assign(capacity, Slot{});
+    }
+
+    std::optional<size_t> find(size_t page_index) const
+    {
+        for (size_t i = hash(page_index);; i = next(i))
+        {
+            if (slots[i].page_index == EMPTY)
+            {
+                return std::nullopt;
+            }
+            if (slots[i].page_index == page_index)
+            {
+                return slots[i].frame;
+            }
+        }
+    }
+
+    void insert(size_t page_index, size_t frame)
+    {
+        size_t i = hash(page_index);
+        while (slots[i].page_index != EMPTY && slots[i].page_index != page_index)
+        {
+            i = next(i);
+        }
+        if (slots[i].page_index == EMPTY)
+        {
+            number_of_pages++;
+        }
+        slots[i] = {page_index, frame};
+    }
+
+    void erase(size_t page_index)
+    {
+        size_t i = hash(page_index);
+        while (slots[i].page_index != page_index)
+        {
+            if (slots[i].page_index == EMPTY)
+            {
+                return;
+            }
+            i = next(i);
+        }
+        number_of_pages--;
+
+        // Backward shift deletion, move following entries of the cluster into the hole
+        size_t hole = i;
+        for (size_t j = next(i); slots[j].page_index != EMPTY; j = next(j))
+        {
+            size_t home = hash(slots[j].page_index);
+            bool can_move = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+            if (can_move)
+            {
+                slots[hole] = slots[j];
+                hole = j;
+            }
+        }
+        slots[hole] = Slot{};
+    }
+
+    void clear()
+    {
+        slots.assign(slots.size(), Slot{});
+        number_of_pages = 0;
+    }
+
+    size_t size() const { return number_of_pages; }
+
+private:
+    static constexpr size_t EMPTY = -1ULL;
+
+    struct Slot
+    {
+        size_t page_index = EMPTY;
+        size_t frame = 0;
+    };
+
+    size_t hash(size_t page_index) const
+    {
+        // Multiplying by an odd constant keeps consecutive page indexes in different slots
+        return (page_index * 11400714819323198485ULL) & (slots.size() - 1);
+    }
+
+    size_t next(size_t i) const
+    {
+        return (i + 1) & (slots.size() - 1);
+    }
+
+    std::vector<Slot> slots;
+    size_t number_of_pages = 0;
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+enum class ReplacementPolicyType
+{
+    CLOCK,
+    TWO_Q,
+    ARC
+};
+
+// Decides which frame of a PageBuffer should be reused when the buffer is full.
+// Policy only tracks occupied frames, free frames are handed out by the buffer itself.
+class ReplacementPolicy
+{
+public:
+    using IsEvictable = std::function<bool(size_t)>;
+
+    virtual ~ReplacementPolicy() = default;
+
+    // Page already resident in frame was requested again
+    virtual void on_hit(size_t frame) = 0;
+
+    // Page was loaded (or created) into a previously free frame
+    virtual void on_load(size_t frame, size_t page_index) = 0;
+
+    // Page was removed from frame, frame is free again
+    virtual void on_evict(size_t frame, size_t page_index) = 0;
+
+    // Pick frame to evict in order to make room for incoming_page_index
+    virtual std::optional<size_t> choose_victim(size_t incoming_page_index, const IsEvictable &is_evictable) = 0;
+
+    // Forget all state, used when the buffer contents are replaced
+    virtual void reset() = 0;
+};
+
+// Second chance - frames are visited in circular order, referenced frames get their bit cleared
+class ClockPolicy : public ReplacementPolicy
+{
+public:
+    explicit ClockPolicy(size_t number_of_frames);
+
+    void on_hit(size_t frame) override;
+    void on_load(size_t frame, size_t page_index) override;
+    void on_evict(size_t frame, size_t page_index) override;
+    std::optional<size_t> choose_victim(size_t incoming_page_index, const IsEvictable &is_evictable) override;
+    void reset() override;
+
+private:
+    std::vector<bool> occupied;
+    std::vector<bool> referenced;
+    size_t hand = 0;
+};
+
+// 2Q - pages seen once live in FIFO A1in, only pages referenced again (or remembered in A1out) get to Am
+class TwoQueuePolicy : public ReplacementPolicy
+{
+public:
+    explicit TwoQueuePolicy(size_t number_of_frames);
+
+    void on_hit(size_t frame) override;
+    void on_load(size_t frame, size_t page_index) override;
+    void on_evict(size_t frame, size_t page_index) override;
+    std::optional<size_t> choose_victim(size_t incoming_page_index, const IsEvictable &is_evictable) override;
+    void reset() override;
+
+private:
+    // Front is the most recent element
+    std::list<size_t> a1_in;
+    std::list<size_t> am;
+    std::list<size_t> a1_out;
+
+    std::unordered_map<size_t, std::list<size_t>::iterator> a1_in_frames;
+    std::unordered_map<size_t, std::list<size_t>::iterator> am_frames;
+    std::unordered_map<size_t, std::list<size_t>::iterator> a1_out_pages;
+
+    size_t max_a1_in;
+    size_t max_a1_out;
+};
+
+// ARC - balances recency (T1) and frequency (T2) using ghost lists B1 and B2 of recently evicted pages
+class ArcPolicy : public ReplacementPolicy
+{
+public:
+    explicit ArcPolicy(size_t number_of_frames);
+
+    void on_hit(size_t frame) override;
+    void on_load(size_t frame, size_t page_index) override;
+    void on_evict(size_t frame, size_t page_index) override;
+    std::optional<size_t> choose_victim(size_t incoming_page_index, const IsEvictable &is_evictable) override;
+    void reset() override;
+
+private:
+    using List = std::list<size_t>;
+    using Positions = std::unordered_map<size_t, List::iterator>;
+
+    void trim_ghosts();
+
+    // T1 and T2 hold frames, B1 and B2 hold page indexes
+    List t1, t2, b1, b2;
+    Positions t1_frames, t2_frames, b1_pages, b2_pages;
+
+    size_t capacity;
+    size_t target_t1 = 0;
+};
+
+std::unique_ptr<ReplacementPolicy> make_replacement_policy(ReplacementPolicyType type, size_t number_of_frames);
@@ -1,12 +1,14 @@
 #pragma once
 
-#include <fstream>
+#include <memory>
+#include <string>
+
+#include "file_backend.hpp"
+#include "settings.hpp"
 
 struct ScopedFile
 {
-    std::fstream file;
-
-    ScopedFile(const std::string_view &path, bool truncate = false);
+    ScopedFile(const std::string_view &path, bool truncate = false, FileBackendType backend = Settings::DEFAULT_FILE_BACKEND, bool direct_io = false);
     ~ScopedFile();
 
     ScopedFile(const ScopedFile &) = delete;
@@ -22,10 +24,13 @@ struct ScopedFile
     void close();
     void open(const std::string_view &path);
 
-private:
-    void reset_pointers();
+    size_t size();
     void resize(size_t new_size);
+    int get_descriptor() const;
+    void note_external_write(size_t end_offset);
 
+private:
+    std::unique_ptr<FileBackend> backend;
     std::string path;
     bool is_open = true;
 };
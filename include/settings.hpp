@@ -3,30 +3,92 @@
 #include <cstddef>
 #include <string_view>
 
+#include "file_backend.hpp"
+#include "io_engine.hpp"
+#include "learned_index.hpp"
+#include "replacement_policy.hpp"
+
 namespace Settings
 {
-    // Test are written with PAGE_SIZE = 8
-    // constexpr size_t PAGE_SIZE = 4;
-    constexpr size_t PAGE_SIZE = 4;
+    // Entries per page of a new database, stored in the file headers.
+    // Can be changed with --blocking-factor <entries> or --page-size <bytes>.
+    // Test are written with DEFAULT_BLOCKING_FACTOR = 8
+    // constexpr size_t DEFAULT_BLOCKING_FACTOR = 4;
+    constexpr size_t DEFAULT_BLOCKING_FACTOR = 4;
     constexpr size_t DEFAULT_PAGE_BUFFER_SIZE = 8;
+    // Memory shared by index, main and overflow area buffers in bytes, can be changed with --memory-budget <bytes>.
+    // Sized for DEFAULT_PAGE_BUFFER_SIZE frames of 128 bytes per area, the default blocking factor page padded to cache lines.
+    constexpr size_t DEFAULT_MEMORY_BUDGET = 3 * 1024;
+    // Every area keeps at least this many frames, pages held at once during an operation must fit
+    constexpr size_t MIN_FRAMES_PER_AREA = 4;
+    // How many operations pass between splitting the budget again
+    constexpr size_t BUFFER_POOL_REBALANCE_INTERVAL = 16;
+    constexpr size_t CACHE_LINE_SIZE = 64;
+    // Alignment of offsets, sizes and buffers with --direct-io
+    constexpr size_t DIRECT_IO_BLOCK_SIZE = 4096;
+    // Can be changed with --file-backend fstream|posix
+    constexpr FileBackendType DEFAULT_FILE_BACKEND = FileBackendType::POSIX;
+    // Address space reserved for every memory mapped area, mapping grows in MAPPING_GROWTH steps
+    constexpr size_t MAPPING_RESERVATION = 1ULL << 36;
+    constexpr size_t MAPPING_GROWTH = 1 << 20;
+    // Which page gets evicted from a full buffer, can be overridden per PageBuffer
+    constexpr ReplacementPolicyType DEFAULT_REPLACEMENT_POLICY = ReplacementPolicyType::CLOCK;
+    // Asynchronous I/O, thread pool is used when io_uring can't be set up
+    constexpr IoEngineType DEFAULT_IO_ENGINE = IoEngineType::IO_URING;
+    constexpr unsigned IO_QUEUE_DEPTH = 64;
+    constexpr size_t IO_THREAD_POOL_SIZE = 4;
+    // How many pages of the old main area reorganisation reads ahead of its scan
+    constexpr size_t READ_AHEAD_PAGES = 16;
+    // Main area pages a range scan reads ahead, overflow pages their chains start on are read with them
+    constexpr size_t SCAN_READ_AHEAD_PAGES = 16;
+    // Reorganisation builds index levels above the leaf level when it has more pages than this
+    constexpr size_t INDEX_TREE_MIN_LEAF_PAGES = 64;
+    // Bloom filter of every main area page is sized for twice the blocking factor of keys,
+    // page and its overflow chains together
+    constexpr size_t BLOOM_FILTER_BITS_PER_KEY = 10;
+    constexpr size_t BLOOM_FILTER_HASHES = 7;
+    // How start keys of the resident index are searched, can be changed with --index-mode binary|learned
+    constexpr IndexMode DEFAULT_INDEX_MODE = IndexMode::BINARY_SEARCH;
+    // Positions a segment of the learned index may be off by, lookups search twice as many start keys
+    constexpr size_t LEARNED_INDEX_MAX_ERROR = 8;
 
     constexpr std::string_view INDEX_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/index.db";
     constexpr std::string_view MAIN_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/main.db";
     constexpr std::string_view OVERFLOW_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/overflow.db";
+    constexpr std::string_view BLOOM_FILTERS_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/bloom_filters.db";
+    constexpr std::string_view OVERFLOW_FREE_SPACE_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/overflow_free_space.db";
+    constexpr std::string_view LEARNED_INDEX_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/learned_index.db";
+    constexpr std::string_view OVERFLOW_CHAIN_LENGTHS_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/overflow_chain_lengths.db";
 
     constexpr std::string_view TEMP_INDEX_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/temp_index.db";
     constexpr std::string_view TEMP_MAIN_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/temp_main.db";
     constexpr std::string_view TEMP_OVERFLOW_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/temp_overflow.db";
+    // Runs of the external sort are numbered after this prefix
+    constexpr std::string_view TEMP_SORT_RUN_FILE_PATH = "/Users/wojtektrapkowski/studia/semestr_5/struktury_baz_danych/projekt_2_indeksowo_sekwencyjne/data/temp_sort_run_";
 
     constexpr size_t INITIAL_NUMBER_OF_PAGES_IN_OVERFLOW_AREA = 1;
 
-    // When the number of records in overflow area is greater than GAMMA * PAGE_SIZE, reorganisation is performed
+    // When the number of records in overflow area is greater than GAMMA * blocking factor, reorganisation is performed
     constexpr double GAMMA = 1;
     // How many pages should be in overflow area after reorganisation
     // Test are written with BETA = 0.5
     constexpr double BETA = 0.5;
     // constexpr double BETA = 0.5;
-    // How many entries should be in a page after reorganisation
+    // How many entries should be in a page after reorganisation, as a fraction of the blocking factor
     constexpr double ALPHA = 0.5;
-    constexpr size_t NUMBER_OF_ENTRIES_AFTER_REORGANISATION = ALPHA * PAGE_SIZE;
+    // Incremental reorganisation only merges main area pages whose overflow chains hold at least
+    // this many entries, as a fraction of the blocking factor
+    constexpr double DELTA = 0.5;
+    // When more than this fraction of main area pages would be merged, full reorganisation is performed instead
+    constexpr double INCREMENTAL_REORGANISATION_MAX_DAMAGE = 0.25;
+    // Writes kept in memory while reorganisation runs in the background, the next one waits for it to finish
+    constexpr size_t BACKGROUND_REORGANISATION_MAX_DELTA = 1 << 16;
+    // Reorganisation gathers main area pages in key ranges of this many pages, on worker threads when there is more than one
+    constexpr size_t REORGANISATION_PARTITION_PAGES = 256;
+    // Worker threads gathering key ranges, 0 means one per hardware thread
+    constexpr size_t REORGANISATION_THREADS = 0;
+    // Reorganisation writes the new areas in sequential extents of at least this many bytes
+    constexpr size_t REORGANISATION_EXTENT_SIZE = 1 << 20;
+    // Pairs the external sort of bulk load input sorts in memory at once
+    constexpr size_t EXTERNAL_SORT_RUN_PAIRS = 1 << 22;
 }
\ No newline at end of file
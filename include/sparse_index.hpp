@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "learned_index.hpp"
+
+// Top level of the index, kept in memory for the lifetime of the database.
+// Holds the whole leaf level when the index has a single level, the root page otherwise.
+class SparseIndex
+{
+public:
+    // Changing the start keys drops the learned model
+    void clear();
+
+    // Entries have to be appended in ascending order of start keys
+    void append(uint64_t start_key, uint64_t page_index);
+
+    // Page of the level below whose range holds the key, -1 if the key is smaller than every start key.
+    // With a learned model only a window around its prediction is searched, falling back to the whole index when it misses.
+    size_t find(uint64_t key) const;
+
+    // Same as find, but the position of the entry, pages don't have to be in key order
+    size_t find_position(uint64_t key) const;
+
+    uint64_t get_start_key(size_t position) const { return start_keys[position]; }
+    uint64_t get_page_index(size_t position) const { return page_indices[position]; }
+
+    size_t size() const { return start_keys.size(); }
+
+    void fit_model(size_t max_error);
+    // Returns false if there is no model fitted on this many start keys in the file
+    bool load_model(const std::string &path);
+    void save_model(const std::string &path) const;
+
+    bool has_model() const { return model.has_value(); }
+    size_t get_number_of_segments() const { return model ? model->get_number_of_segments() : 0; }
+    size_t get_model_fallback_count() const { return model_fallbacks; }
+
+private:
+    // Position of the last start key in [first, last) not greater than the key, first if there is none
+    size_t search(uint64_t key, size_t first, size_t last) const;
+
+    std::vector<uint64_t> start_keys;
+    std::vector<uint64_t> page_indices;
+
+    std::optional<LearnedIndex> model;
+    mutable size_t model_fallbacks = 0;
+};
@@ -1,8 +1,12 @@
 #pragma once
 
-#include <cstdint>
 #include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
 
+#include "page_search.hpp"
 #include "settings.hpp"
 struct Guardian
 {
@@ -12,12 +16,35 @@ struct Guardian
 struct Header
 {
     uint64_t number_of_pages = 0;
+    // Entries per page, chosen when the file is created
+    uint64_t blocking_factor = 0;
+};
+
+struct IndexAreaHeader
+{
+    uint64_t number_of_pages = 0;
+    uint64_t blocking_factor = 0;
+    // Levels above the leaf level are stored after it, level by level, the root is the last page
+    uint64_t root_page_index = 0;
+    uint64_t number_of_levels = 1;
+};
+
+struct OverflowAreaHeader
+{
+    uint64_t number_of_pages = 0;
+    uint64_t blocking_factor = 0;
+    // Taken slots, including deleted entries, only reorganisation frees them
+    uint64_t number_of_entries = 0;
 };
 
 struct MainAreaHeader
 {
     uint64_t number_of_pages = 0;
     uint64_t overflow_page_index = -1; // our guardian
+    uint64_t blocking_factor = 0;
+    // Sidecar files are only trusted when they were saved with the same generation,
+    // it changes on disk whenever the database is opened or flushed
+    uint64_t generation = 0;
 };
 
 struct PageEntry
@@ -28,22 +55,111 @@ struct PageEntry
     uint64_t was_deleted = 0;
 };
 
-struct Page
-{
-    uint64_t index = -1;
-    uint64_t number_of_entries = 0;
-    std::array<PageEntry, Settings::PAGE_SIZE> entries;
-};
-
 struct IndexEntry
 {
     uint64_t start_key = -1;
     uint64_t page_index = -1;
 };
 
-struct IndexPage
+// Blocking factor is a template parameter, so loops over entries have constant bounds.
+// Which instantiation is used is decided from the file headers when the database is opened.
+template <typename Entry, size_t BlockingFactor>
+struct BasicPage
 {
+    static constexpr size_t BLOCKING_FACTOR = BlockingFactor;
+
     uint64_t index = -1;
     uint64_t number_of_entries = 0;
-    std::array<IndexEntry, Settings::PAGE_SIZE> entries;
-};
\ No newline at end of file
+    std::array<Entry, BlockingFactor> entry_array;
+
+    std::span<Entry, BlockingFactor> entries()
+    {
+        return entry_array;
+    }
+
+    std::span<const Entry, BlockingFactor> entries() const
+    {
+        return entry_array;
+    }
+};
+
+// Entries of main and overflow area are stored column-wise: keys, values and overflow pointers each
+// form a contiguous array, deleted entries are marked in a bitmap. Searching a page only touches its keys.
+template <size_t BlockingFactor>
+struct Page
+{
+    static constexpr size_t BLOCKING_FACTOR = BlockingFactor;
+    static constexpr size_t BITMAP_WORDS = (BlockingFactor + 63) / 64;
+    // Deleted overflow entry with this key is a slot given back by incremental reorganisation, no chain links to it
+    static constexpr uint64_t RECLAIMED_KEY = -1;
+
+    uint64_t index = -1;
+    uint64_t number_of_entries = 0;
+    std::array<uint64_t, BlockingFactor> keys;
+    std::array<uint64_t, BlockingFactor> values;
+    std::array<uint64_t, BlockingFactor> overflow_entry_indices;
+    std::array<uint64_t, BITMAP_WORDS> deleted;
+
+    Page()
+    {
+        keys.fill(-1);
+        values.fill(-1);
+        overflow_entry_indices.fill(-1);
+        deleted.fill(0);
+    }
+
+    bool is_deleted(size_t pos) const
+    {
+        return (deleted[pos / 64] >> (pos % 64)) & 1;
+    }
+
+    void set_deleted(size_t pos, bool is_deleted = true)
+    {
+        uint64_t bit = 1ULL << (pos % 64);
+        deleted[pos / 64] = is_deleted ? deleted[pos / 64] | bit : deleted[pos / 64] & ~bit;
+    }
+
+    PageEntry get_entry(size_t pos) const
+    {
+        return {keys[pos], values[pos], overflow_entry_indices[pos], is_deleted(pos)};
+    }
+
+    void set_entry(size_t pos, const PageEntry &entry)
+    {
+        keys[pos] = entry.key;
+        values[pos] = entry.value;
+        overflow_entry_indices[pos] = entry.overflow_entry_index;
+        set_deleted(pos, entry.was_deleted);
+    }
+
+    void set_reclaimed(size_t pos)
+    {
+        set_entry(pos, {RECLAIMED_KEY, RECLAIMED_KEY, -1ULL, true});
+    }
+
+    // Slot for a new overflow entry, reclaimed slots before unused ones, BLOCKING_FACTOR when the page is full
+    size_t find_free_slot() const
+    {
+        for (size_t word = 0; word < BITMAP_WORDS; ++word)
+        {
+            for (uint64_t bits = deleted[word]; bits; bits &= bits - 1)
+            {
+                size_t pos = word * 64 + std::countr_zero(bits);
+                if (pos < number_of_entries && keys[pos] == RECLAIMED_KEY)
+                {
+                    return pos;
+                }
+            }
+        }
+        return number_of_entries;
+    }
+
+    // Position of the first entry with key greater than the given one, number_of_entries if there is none
+    size_t find_first_greater(uint64_t key) const
+    {
+        return ::find_first_greater(keys.data(), number_of_entries, key);
+    }
+};
+
+template <size_t BlockingFactor>
+using IndexPage = BasicPage<IndexEntry, BlockingFactor>;
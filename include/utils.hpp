@@ -1,9 +1,24 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <set>
+#include <string>
+#include <vector>
 
 std::pair<std::set<uint64_t>, std::set<uint64_t>> generate_keys_and_values(size_t number_of_keys);
 
 uint64_t generate_key();
 
-uint64_t generate_pesel();
\ No newline at end of file
+uint64_t generate_pesel();
+
+// Smallest multiple of alignment which is not less than value
+constexpr size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Sidecar file holding a vector of counters, load returns false if it is missing, holds a different number of them
+// or was saved with a different generation
+bool load_counters(const std::string &path, std::vector<uint64_t> &counters, size_t number_of_counters, uint64_t generation);
+void save_counters(const std::string &path, const std::vector<uint64_t> &counters, uint64_t generation);
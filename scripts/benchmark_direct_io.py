@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+import sys
+import os
+import subprocess
+import tempfile
+import time
+
+
+MODES = {"buffered": [], "direct": ["--direct-io"]}
+# Memory budgets in MiB, direct I/O frames take a whole 4 KiB block so fewer of them fit
+MEMORY_BUDGETS = [1, 4, 16]
+
+
+def run_benchmark(binary, mode_arguments, memory_budget, number_of_keys):
+    with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as f:
+        f.write(f"generate {number_of_keys}\n")
+        f.write("reorganise\n")
+        f.write("print_stats\n")
+        commands_file = f.name
+
+    try:
+        # Start every run from empty database files
+        subprocess.run([binary, "--clean"], check=True)
+
+        start = time.perf_counter()
+        result = subprocess.run(
+            [binary, "--memory-budget", str(memory_budget * 1024 * 1024), *mode_arguments, commands_file],
+            stdout=subprocess.PIPE,
+            text=True,
+            check=True,
+        )
+        elapsed = time.perf_counter() - start
+    finally:
+        os.remove(commands_file)
+
+    # Only the summary printed by print_stats is interesting
+    hits = 0
+    misses = 0
+    reads = 0
+    for line in result.stdout.splitlines():
+        name, _, value = line.partition(":")
+        if name.endswith("buffer hits"):
+            hits += int(value)
+        elif name.endswith("buffer misses"):
+            misses += int(value)
+        elif name == "Combined reads":
+            reads = int(value)
+
+    hit_rate = hits / (hits + misses) if hits + misses > 0 else 0
+    return elapsed, hit_rate, reads
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python benchmark_direct_io.py <path_to_SBD_2> [number_of_keys]")
+        sys.exit(1)
+
+    binary = sys.argv[1]
+    number_of_keys = int(sys.argv[2]) if len(sys.argv) > 2 else 3000
+
+    print(f"generate {number_of_keys}, reorganise")
+    print(f"{'mode':<10}{'budget [MiB]':>14}{'time [s]':>12}{'hit rate':>12}{'reads':>12}")
+    for memory_budget in MEMORY_BUDGETS:
+        for mode, mode_arguments in MODES.items():
+            elapsed, hit_rate, reads = run_benchmark(binary, mode_arguments, memory_budget, number_of_keys)
+            print(f"{mode:<10}{memory_budget:>14}{elapsed:>12.2f}{hit_rate:>12.2%}{reads:>12}")
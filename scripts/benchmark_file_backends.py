@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+import sys
+import os
+import subprocess
+import tempfile
+import time
+
+
+BACKENDS = ["fstream", "posix"]
+
+
+def run_benchmark(binary, backend, number_of_keys):
+    with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as f:
+        f.write(f"generate {number_of_keys}\n")
+        f.write("print_stats\n")
+        commands_file = f.name
+
+    try:
+        # Start every run from empty database files
+        subprocess.run([binary, "--clean"], check=True)
+
+        start = time.perf_counter()
+        result = subprocess.run(
+            [binary, "--file-backend", backend, commands_file],
+            stdout=subprocess.PIPE,
+            text=True,
+            check=True,
+        )
+        elapsed = time.perf_counter() - start
+    finally:
+        os.remove(commands_file)
+
+    # Only the summary printed by print_stats is interesting
+    stats = {}
+    for line in result.stdout.splitlines():
+        if line.startswith("Combined reads:") or line.startswith("Combined writes:"):
+            name, value = line.split(":")
+            stats[name] = int(value)
+
+    return elapsed, stats
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python benchmark_file_backends.py <path_to_SBD_2> [number_of_keys]")
+        sys.exit(1)
+
+    binary = sys.argv[1]
+    number_of_keys = int(sys.argv[2]) if len(sys.argv) > 2 else 100000
+
+    print(f"generate {number_of_keys}")
+    print(f"{'backend':<10}{'time [s]':>12}{'reads':>12}{'writes':>12}")
+    for backend in BACKENDS:
+        elapsed, stats = run_benchmark(binary, backend, number_of_keys)
+        print(f"{backend:<10}{elapsed:>12.2f}{stats.get('Combined reads', 0):>12}{stats.get('Combined writes', 0):>12}")
@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+import sys
+import os
+import random
+import subprocess
+import tempfile
+import time
+
+
+MODES = ["binary", "learned"]
+
+
+def uniform_keys(number_of_keys):
+    # Same range as generate_key()
+    return random.sample(range(1, 2**32), number_of_keys)
+
+
+def skewed_keys(number_of_keys):
+    # Most keys in a few dense clusters, the rest spread thinly between them
+    keys = set()
+    centres = [random.randrange(2**20, 2**32 - 2**20) for _ in range(8)]
+    while len(keys) < number_of_keys:
+        if random.random() < 0.9:
+            keys.add(random.choice(centres) + int(random.expovariate(1 / 2000)))
+        else:
+            keys.add(random.randrange(1, 2**32))
+    return list(keys)
+
+
+KEY_SETS = {"uniform": uniform_keys, "skewed": skewed_keys}
+
+
+def write_commands(lines):
+    with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as f:
+        f.write("\n".join(lines) + "\n")
+        return f.name
+
+
+def run(binary, arguments, commands_file):
+    start = time.perf_counter()
+    result = subprocess.run([binary, *arguments, commands_file], stdout=subprocess.PIPE, text=True, check=True)
+    return time.perf_counter() - start, result.stdout
+
+
+def run_benchmark(binary, keys, index_mode, number_of_searches):
+    # Database is built once per run, only the searches are timed
+    setup_file = write_commands([f"insert {key} {i}" for i, key in enumerate(keys)] + ["reorganise"])
+    searched = [random.choice(keys) if random.random() < 0.5 else random.randrange(1, 2**32) for _ in range(number_of_searches)]
+    search_file = write_commands([f"search {key}" for key in searched] + ["print_stats"])
+
+    try:
+        subprocess.run([binary, "--clean"], check=True)
+        run(binary, ["--index-mode", index_mode], setup_file)
+        elapsed, output = run(binary, ["--index-mode", index_mode], search_file)
+    finally:
+        os.remove(setup_file)
+        os.remove(search_file)
+
+    segments = 0
+    fallbacks = 0
+    for line in output.splitlines():
+        name, _, value = line.partition(":")
+        if name == "Learned index segments":
+            segments = int(value)
+        elif name == "Learned index fallbacks":
+            fallbacks = int(value)
+    return elapsed, segments, fallbacks
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python benchmark_index_modes.py <path_to_SBD_2> [number_of_keys] [number_of_searches]")
+        sys.exit(1)
+
+    binary = sys.argv[1]
+    number_of_keys = int(sys.argv[2]) if len(sys.argv) > 2 else 5000
+    number_of_searches = int(sys.argv[3]) if len(sys.argv) > 3 else 5000
+
+    print(f"{number_of_keys} keys, {number_of_searches} searches")
+    print(f"{'keys':<10}{'mode':<10}{'time [s]':>12}{'segments':>12}{'fallbacks':>12}")
+    for key_set, make_keys in KEY_SETS.items():
+        keys = make_keys(number_of_keys)
+        for index_mode in MODES:
+            elapsed, segments, fallbacks = run_benchmark(binary, keys, index_mode, number_of_searches)
+            print(f"{key_set:<10}{index_mode:<10}{elapsed:>12.2f}{segments:>12}{fallbacks:>12}")
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+import sys
+import os
+import random
+import subprocess
+import tempfile
+import time
+
+
+MODES = {"buffered": [], "direct": ["--direct-io"], "mmap": ["--mmap"]}
+
+
+def write_commands(lines):
+    with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as f:
+        f.write("\n".join(lines) + "\n")
+        return f.name
+
+
+def run(binary, arguments, commands_file):
+    start = time.perf_counter()
+    result = subprocess.run([binary, *arguments, commands_file], stdout=subprocess.PIPE, text=True, check=True)
+    return time.perf_counter() - start, result.stdout
+
+
+def run_benchmark(binary, mode_arguments, number_of_keys, number_of_overflow_keys):
+    # Generated keys fill the main area, inserts after them go to the overflow chains
+    setup_file = write_commands(["generate " + str(number_of_keys)] + [f"insert {random.randrange(1, 2**32)} {i}" for i in range(number_of_overflow_keys)])
+    scan_file = write_commands(["scan 0 18446744073709551615"])
+    empty_file = write_commands([""])
+
+    try:
+        subprocess.run([binary, "--clean"], check=True)
+        run(binary, mode_arguments, setup_file)
+        # Opening the database is not part of the scan
+        baseline, _ = run(binary, mode_arguments, empty_file)
+        elapsed, output = run(binary, mode_arguments, scan_file)
+    finally:
+        os.remove(setup_file)
+        os.remove(scan_file)
+        os.remove(empty_file)
+
+    records = 0
+    main_reads = 0
+    overflow_reads = 0
+    for line in output.splitlines():
+        name, _, value = line.partition(":")
+        if name == "Main area reads":
+            main_reads = int(value)
+        elif name == "Overflow area reads":
+            overflow_reads = int(value)
+        elif " " in line and ":" not in line:
+            records += 1
+    return records, max(elapsed - baseline, 1e-9), main_reads, overflow_reads
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python benchmark_scan.py <path_to_SBD_2> [number_of_keys] [number_of_overflow_keys]")
+        sys.exit(1)
+
+    binary = sys.argv[1]
+    number_of_keys = int(sys.argv[2]) if len(sys.argv) > 2 else 200000
+    number_of_overflow_keys = int(sys.argv[3]) if len(sys.argv) > 3 else 2000
+
+    print(f"{number_of_keys} generated keys, {number_of_overflow_keys} inserted into overflow chains")
+    print(f"{'mode':<10}{'records':>10}{'time [s]':>12}{'records/s':>14}{'main reads':>12}{'overflow reads':>16}")
+    for mode, mode_arguments in MODES.items():
+        records, elapsed, main_reads, overflow_reads = run_benchmark(binary, mode_arguments, number_of_keys, number_of_overflow_keys)
+        print(f"{mode:<10}{records:>10}{elapsed:>12.2f}{records / elapsed:>14.0f}{main_reads:>12}{overflow_reads:>16}")
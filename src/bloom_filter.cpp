@@ -0,0 +1,108 @@
+#include "bloom_filter.hpp"
+#include "settings.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    struct BloomFiltersHeader
+    {
+        uint64_t number_of_filters;
+        uint64_t bits_per_filter;
+        uint64_t generation;
+    };
+
+    // Finalizer of splitmix64, sequential keys end up far apart
+    uint64_t mix(uint64_t key)
+    {
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return key;
+    }
+}
+
+void BloomFilters::reset(size_t number_of_filters, size_t bits_per_filter)
+{
+    this->number_of_filters = number_of_filters;
+    this->bits_per_filter = bits_per_filter;
+    words_per_filter = (bits_per_filter + 63) / 64;
+    words.assign(number_of_filters * words_per_filter, 0);
+}
+
+void BloomFilters::add(size_t filter, uint64_t key)
+{
+    uint64_t *filter_words = words.data() + filter * words_per_filter;
+    // Double hashing, both halves of a single hash give every probe
+    uint64_t hash = mix(key);
+    uint64_t first = hash & 0xffffffffULL;
+    uint64_t step = (hash >> 32) | 1;
+    for (size_t i = 0; i < Settings::BLOOM_FILTER_HASHES; ++i)
+    {
+        size_t bit = (first + i * step) % bits_per_filter;
+        filter_words[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+void BloomFilters::clear(size_t filter)
+{
+    std::fill_n(words.begin() + filter * words_per_filter, words_per_filter, 0);
+}
+
+void BloomFilters::insert_empty(size_t filter, size_t count)
+{
+    words.insert(words.begin() + filter * words_per_filter, count * words_per_filter, 0);
+    number_of_filters += count;
+}
+
+bool BloomFilters::may_contain(size_t filter, uint64_t key) const
+{
+    const uint64_t *filter_words = words.data() + filter * words_per_filter;
+    uint64_t hash = mix(key);
+    uint64_t first = hash & 0xffffffffULL;
+    uint64_t step = (hash >> 32) | 1;
+    for (size_t i = 0; i < Settings::BLOOM_FILTER_HASHES; ++i)
+    {
+        size_t bit = (first + i * step) % bits_per_filter;
+        if (!(filter_words[bit / 64] & (1ULL << (bit % 64))))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BloomFilters::load(const std::string &path, size_t number_of_filters, size_t bits_per_filter, uint64_t generation)
+{
+    std::ifstream file(path, std::ios::binary);
+    BloomFiltersHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(BloomFiltersHeader)) ||
+        header.number_of_filters != number_of_filters || header.bits_per_filter != bits_per_filter || header.generation != generation)
+    {
+        return false;
+    }
+
+    reset(number_of_filters, bits_per_filter);
+    if (!file.read(reinterpret_cast<char *>(words.data()), words.size() * sizeof(uint64_t)))
+    {
+        reset(number_of_filters, bits_per_filter);
+        return false;
+    }
+    return true;
+}
+
+void BloomFilters::save(const std::string &path, uint64_t generation) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    BloomFiltersHeader header{number_of_filters, bits_per_filter, generation};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(BloomFiltersHeader));
+    file.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write bloom filters");
+    }
+}
@@ -0,0 +1,134 @@
+#include "buffer_pool.hpp"
+#include "settings.hpp"
+#include "debug.hpp"
+
+#include <algorithm>
+
+BufferPool::BufferPool(size_t memory_budget) : memory_budget(memory_budget)
+{
+}
+
+void BufferPool::attach(ManagedBuffer &buffer, bool has_priority)
+{
+    members.push_back({&buffer, has_priority, buffer.get_total_hit_count(), buffer.get_total_miss_count()});
+    rebalance();
+}
+
+void BufferPool::rebalance()
+{
+    operations_since_rebalance = 0;
+    if (members.empty())
+    {
+        return;
+    }
+
+    // Resizing reallocates frames, pinned pages would be left dangling
+    for (const auto &member : members)
+    {
+        if (member.buffer->get_pinned_frame_count() > 0)
+        {
+            return;
+        }
+    }
+
+    std::vector<size_t> frames(members.size(), Settings::MIN_FRAMES_PER_AREA);
+    size_t remaining_budget = memory_budget;
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        size_t minimum = Settings::MIN_FRAMES_PER_AREA * members[i].buffer->get_frame_size();
+        remaining_budget -= std::min(remaining_budget, minimum);
+    }
+
+    // One spare frame for page which may be created next
+    auto wanted_frames = [&](size_t i)
+    {
+        return members[i].buffer->get_number_of_pages() + 1;
+    };
+
+    // Priority buffers (index area) are given frames for all of their pages first
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        if (!members[i].has_priority || frames[i] >= wanted_frames(i))
+        {
+            continue;
+        }
+        size_t frame_size = members[i].buffer->get_frame_size();
+        size_t extra = std::min(wanted_frames(i) - frames[i], remaining_budget / frame_size);
+        frames[i] += extra;
+        remaining_budget -= extra * frame_size;
+    }
+
+    // Rest of the budget is split proportionally to misses since last rebalance.
+    // Repeat while budget was left over by buffers which got everything they want.
+    std::vector<double> weights(members.size());
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        size_t misses = members[i].buffer->get_total_miss_count() - members[i].last_miss_count;
+        // Smoothing, buffers without misses still get a share
+        weights[i] = members[i].has_priority ? 0 : misses + 1.0;
+    }
+
+    for (size_t round = 0; round < members.size() && remaining_budget > 0; ++round)
+    {
+        double weight_sum = 0;
+        for (size_t i = 0; i < members.size(); ++i)
+        {
+            if (frames[i] < wanted_frames(i))
+            {
+                weight_sum += weights[i];
+            }
+        }
+        if (weight_sum == 0)
+        {
+            break;
+        }
+
+        size_t budget_for_round = remaining_budget;
+        for (size_t i = 0; i < members.size(); ++i)
+        {
+            if (frames[i] >= wanted_frames(i) || weights[i] == 0)
+            {
+                continue;
+            }
+            size_t frame_size = members[i].buffer->get_frame_size();
+            size_t share = static_cast<size_t>(budget_for_round * (weights[i] / weight_sum)) / frame_size;
+            size_t extra = std::min({share, wanted_frames(i) - frames[i], remaining_budget / frame_size});
+            frames[i] += extra;
+            remaining_budget -= extra * frame_size;
+        }
+    }
+
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        if (frames[i] != members[i].buffer->get_number_of_frames())
+        {
+            DEBUG_CERR << "Buffer pool: member " << i << " " << members[i].buffer->get_number_of_frames() << " -> " << frames[i] << " frames" << std::endl;
+            members[i].buffer->set_number_of_frames(frames[i]);
+        }
+        members[i].last_hit_count = members[i].buffer->get_total_hit_count();
+        members[i].last_miss_count = members[i].buffer->get_total_miss_count();
+    }
+}
+
+size_t BufferPool::report_pinned_frames() const
+{
+    size_t pinned_frames = 0;
+    for (size_t i = 0; i < members.size(); ++i)
+    {
+        if (size_t pinned = members[i].buffer->get_pinned_frame_count())
+        {
+            DEBUG_CERR << "Buffer pool: member " << i << " has " << pinned << " pinned frames" << std::endl;
+            pinned_frames += pinned;
+        }
+    }
+    return pinned_frames;
+}
+
+void BufferPool::on_operation()
+{
+    operations_since_rebalance++;
+    if (operations_since_rebalance >= Settings::BUFFER_POOL_REBALANCE_INTERVAL)
+    {
+        rebalance();
+    }
+}
@@ -4,6 +4,7 @@
 
 #include "command_parser.hpp"
 #include "debug.hpp"
+#include "external_sort.hpp"
 #include "utils.hpp"
 
 CommandParser::CommandParser(Database &db) : database(db) {}
@@ -72,6 +73,48 @@ void CommandParser::process_command(const std::string &line)
             std::cout << "Invalid command. Type 'help' for available commands.\n";
         }
     }
+    else if (command == "upsert")
+    {
+        uint64_t key, value;
+        if (iss >> key >> value)
+        {
+            database.upsert(key, value);
+        }
+        else
+        {
+            std::cout << "Invalid command. Type 'help' for available commands.\n";
+        }
+    }
+    else if (command == "insert_if_absent")
+    {
+        uint64_t key, value;
+        if (iss >> key >> value)
+        {
+            if (!database.insert_if_absent(key, value))
+            {
+                std::cout << "Already exists: " << key << std::endl;
+            }
+        }
+        else
+        {
+            std::cout << "Invalid command. Type 'help' for available commands.\n";
+        }
+    }
+    else if (command == "compare_and_set")
+    {
+        uint64_t key, expected, value;
+        if (iss >> key >> expected >> value)
+        {
+            if (!database.compare_and_set(key, expected, value))
+            {
+                std::cout << "Not set: " << key << std::endl;
+            }
+        }
+        else
+        {
+            std::cout << "Invalid command. Type 'help' for available commands.\n";
+        }
+    }
     else if (command == "flush")
     {
         database.flush();
@@ -100,6 +143,42 @@ void CommandParser::process_command(const std::string &line)
             }
         }
     }
+    else if (command == "multi_search")
+    {
+        std::vector<uint64_t> keys;
+        uint64_t key;
+        while (iss >> key)
+        {
+            keys.push_back(key);
+        }
+        auto results = database.multi_search(keys);
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (results[i])
+            {
+                std::cout << *results[i] << std::endl;
+            }
+            else
+            {
+                std::cout << "Not found: " << keys[i] << std::endl;
+            }
+        }
+    }
+    else if (command == "scan")
+    {
+        uint64_t lo, hi;
+        if (iss >> lo >> hi)
+        {
+            for (auto [key, value] : database.scan(lo, hi))
+            {
+                std::cout << key << " " << value << "\n";
+            }
+        }
+        else
+        {
+            std::cout << "Invalid command. Type 'help' for available commands.\n";
+        }
+    }
     else if (command == "print")
     {
         database.print();
@@ -115,27 +194,65 @@ void CommandParser::process_command(const std::string &line)
         {
             // Number of keys should be checked before generating
             auto [keys, values] = generate_keys_and_values(number_of_keys);
-            for (size_t i = 0; i < number_of_keys; i++)
+            // Keys come sorted, so they are loaded in one pass instead of inserted one by one
+            std::vector<std::pair<uint64_t, uint64_t>> pairs;
+            pairs.reserve(number_of_keys);
+            for (auto key = keys.begin(), value = values.begin(); key != keys.end(); ++key, ++value)
             {
-                database.insert(keys.extract(keys.begin()).value(), values.extract(values.begin()).value());
+                pairs.emplace_back(*key, *value);
             }
+            database.bulk_load(pairs);
+        }
+    }
+    else if (command == "load")
+    {
+        std::string filename;
+        if (iss >> filename)
+        {
+            std::ifstream file(filename);
+            if (!file)
+            {
+                throw std::runtime_error("Cannot open file: " + filename);
+            }
+            // Input doesn't have to be sorted
+            ExternalSort pairs(file);
+            database.bulk_load(pairs);
+        }
+        else
+        {
+            std::cout << "Invalid command. Type 'help' for available commands.\n";
         }
     }
     else if (command == "reorganise")
     {
-        database.reorganise();
+        std::string mode;
+        iss >> mode;
+        if (mode == "incremental")
+        {
+            database.reorganise_incremental();
+        }
+        else
+        {
+            database.reorganise();
+        }
     }
     else if (command == "help")
     {
         std::cout << "Available commands:\n"
                   << "  insert <key> <value>\n"
                   << "  update <key> <value>\n"
+                  << "  upsert <key> <value>\n"
+                  << "  insert_if_absent <key> <value>\n"
+                  << "  compare_and_set <key> <expected> <value>\n"
                   << "  search <key>\n"
+                  << "  multi_search <key>...\n"
+                  << "  scan <lo> <hi>\n"
                   << "  print\n"
                   << "  print_stats\n"
                   << "  remove <key>\n"
                   << "  generate <number_of_keys>\n"
-                  << "  reorganise\n"
+                  << "  load <file>\n"
+                  << "  reorganise [incremental]\n"
                   << "  help\n"
                   << "  exit/quit\n";
     }
@@ -0,0 +1,2361 @@
+#include "database_engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "debug.hpp"
+
+namespace
+{
+    BufferOptions with_storage_mode(BufferOptions options, StorageMode storage_mode)
+    {
+        options.storage_mode = storage_mode;
+        return options;
+    }
+
+    BufferOptions with_read_only(BufferOptions options, bool read_only)
+    {
+        options.read_only = read_only;
+        return options;
+    }
+}
+
+template <size_t BlockingFactor>
+BasicDatabase<BlockingFactor>::BasicDatabase(const DatabaseOptions &options)
+    : index_area(Settings::INDEX_FILE_PATH, false, with_storage_mode(options.buffer_options, options.index_and_main_storage)),
+      main_area(Settings::MAIN_FILE_PATH, false, with_storage_mode(options.buffer_options, options.index_and_main_storage)),
+      overflow_area(Settings::OVERFLOW_FILE_PATH, false, options.buffer_options),
+      index_mode(options.index_mode),
+      reorganisation_mode(options.reorganisation_mode),
+      buffer_pool(options.memory_budget)
+{
+    if (index_area.get_page(0)->number_of_entries == 0)
+    {
+        auto index_root = index_area.get_page_for_write(0);
+        index_root->entries()[0] = {0, 0};
+        index_root->number_of_entries = 1;
+    }
+
+    for (size_t i = 1; i < Settings::INITIAL_NUMBER_OF_PAGES_IN_OVERFLOW_AREA; ++i)
+    {
+        overflow_area.create_page();
+    }
+
+    guardian = {main_area.get_header().overflow_page_index};
+
+    load_sparse_index();
+    if (index_mode == IndexMode::LEARNED && !sparse_index.load_model(std::string(Settings::LEARNED_INDEX_FILE_PATH)))
+    {
+        fit_learned_index();
+    }
+
+    // Sidecar file is missing or stale when the database was created by an older version or the process
+    // died before it was saved, then its generation doesn't match the header
+    uint64_t generation = main_area.get_header().generation;
+    if (!bloom_filters.load(std::string(Settings::BLOOM_FILTERS_FILE_PATH), main_area.get_header().number_of_pages + 1, BLOOM_FILTER_BITS, generation))
+    {
+        rebuild_bloom_filters();
+    }
+    if (!free_space_map.load(std::string(Settings::OVERFLOW_FREE_SPACE_FILE_PATH), overflow_area.get_header().number_of_pages, generation))
+    {
+        rebuild_free_space_map();
+    }
+    if (!load_counters(std::string(Settings::OVERFLOW_CHAIN_LENGTHS_FILE_PATH), overflow_chain_lengths, main_area.get_header().number_of_pages + 1, generation))
+    {
+        rebuild_overflow_chain_lengths();
+    }
+    start_new_generation();
+
+    // Lookups start in the sparse index, index area is only read below the root of a multi-level index.
+    // Memory mapped areas don't use frames, page cache holds their pages.
+    if (options.index_and_main_storage == StorageMode::BUFFERED)
+    {
+        buffer_pool.attach(index_area);
+        buffer_pool.attach(main_area);
+    }
+    buffer_pool.attach(overflow_area);
+}
+
+template <size_t BlockingFactor>
+BasicDatabase<BlockingFactor>::~BasicDatabase()
+{
+    try
+    {
+        finish_background_reorganisation();
+    }
+    catch (const std::exception &e)
+    {
+        DEBUG_CERR << "Error: " << e.what() << std::endl;
+    }
+
+    auto &header = main_area.get_header();
+    header.overflow_page_index = guardian.overflow_page_index;
+
+    try
+    {
+        index_area.flush();
+        main_area.flush();
+        overflow_area.flush();
+        save_sidecar_files();
+    }
+    catch (const std::exception &e)
+    {
+        DEBUG_CERR << "Error: " << e.what() << std::endl;
+    }
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::print()
+{
+    clear_counters();
+    finish_background_reorganisation();
+    print_wrapper();
+    print_stats_after_operation(OperationType::PRINT);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::print_stats()
+{
+    std::cout << "Disk operations statistics:\n";
+    std::cout << "Index area reads: " << IndexArea::get_all_read_count() << "\n";
+    std::cout << "Index area writes: " << IndexArea::get_all_write_count() << "\n";
+
+    std::cout << "Main area reads: " << MainArea::get_all_read_count() << "\n";
+    std::cout << "Main area writes: " << MainArea::get_all_write_count() << "\n";
+
+    std::cout << "Overflow area reads: " << OverflowArea::get_all_read_count() << "\n";
+    std::cout << "Overflow area writes: " << OverflowArea::get_all_write_count() << "\n";
+
+    std::cout << "Index area buffer hits: " << IndexArea::get_all_hit_count() << "\n";
+    std::cout << "Index area buffer misses: " << IndexArea::get_all_miss_count() << "\n";
+
+    std::cout << "Main area buffer hits: " << MainArea::get_all_hit_count() << "\n";
+    std::cout << "Main area buffer misses: " << MainArea::get_all_miss_count() << "\n";
+
+    std::cout << "Overflow area buffer hits: " << OverflowArea::get_all_hit_count() << "\n";
+    std::cout << "Overflow area buffer misses: " << OverflowArea::get_all_miss_count() << "\n";
+
+    std::cout << "Combined reads: " << IndexArea::get_all_read_count() + MainArea::get_all_read_count() + OverflowArea::get_all_read_count() << "\n";
+    std::cout << "Combined writes: " << IndexArea::get_all_write_count() + MainArea::get_all_write_count() + OverflowArea::get_all_write_count() << "\n";
+
+    double false_positive_rate = absent_key_lookups == 0 ? 0 : static_cast<double>(bloom_filter_false_positives) / absent_key_lookups;
+    std::cout << "Bloom filter false positive rate: " << false_positive_rate
+              << " (" << bloom_filter_false_positives << " of " << absent_key_lookups << " lookups of absent keys)" << "\n";
+
+    double pages_per_chain_walk = overflow_chain_walks == 0 ? 0 : static_cast<double>(overflow_chain_walk_pages) / overflow_chain_walks;
+    std::cout << "Average overflow pages per chain walk: " << pages_per_chain_walk
+              << " (" << overflow_chain_walks << " walks)" << "\n";
+    std::cout << "Page search kernel: " << get_page_search_kernel() << std::endl;
+
+    if (sparse_index.has_model())
+    {
+        std::cout << "Learned index segments: " << sparse_index.get_number_of_segments() << "\n";
+        std::cout << "Learned index fallbacks: " << sparse_index.get_model_fallback_count() << std::endl;
+    }
+}
+// Helper function to find entry in overflow chain
+template <size_t BlockingFactor>
+std::optional<EntryLocation> BasicDatabase<BlockingFactor>::search_overflow_chain(size_t start_index, uint64_t key)
+{
+    size_t current_index = start_index;
+    std::vector<size_t> visited_pages;
+    std::optional<EntryLocation> result;
+
+    while (current_index != -1ULL)
+    {
+        auto page = overflow_area.get_page(current_index / BLOCKING_FACTOR);
+        size_t pos = current_index % BLOCKING_FACTOR;
+        if (std::find(visited_pages.begin(), visited_pages.end(), page->index) == visited_pages.end())
+        {
+            visited_pages.push_back(page->index);
+        }
+
+        if (page->is_deleted(pos))
+        {
+            current_index = page->overflow_entry_indices[pos];
+            continue;
+        }
+
+        if (page->keys[pos] == key)
+        {
+            result = EntryLocation{true, current_index / BLOCKING_FACTOR, pos};
+            break;
+        }
+        current_index = page->overflow_entry_indices[pos];
+    }
+
+    record_chain_walk(visited_pages);
+    return result;
+}
+
+// Helper function to look up sorted keys in a single walk of an overflow chain, values of the found ones are set.
+// Walk stops once every key is found.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::search_overflow_chain(size_t start_index, std::span<const uint64_t> keys, std::span<std::optional<uint64_t>> values)
+{
+    size_t current_index = start_index;
+    size_t remaining = keys.size();
+    std::vector<size_t> visited_pages;
+
+    while (current_index != -1ULL && remaining > 0)
+    {
+        auto page = overflow_area.get_page(current_index / BLOCKING_FACTOR);
+        size_t pos = current_index % BLOCKING_FACTOR;
+        if (std::find(visited_pages.begin(), visited_pages.end(), page->index) == visited_pages.end())
+        {
+            visited_pages.push_back(page->index);
+        }
+
+        if (!page->is_deleted(pos))
+        {
+            auto it = std::lower_bound(keys.begin(), keys.end(), page->keys[pos]);
+            size_t i = it - keys.begin();
+            if (it != keys.end() && *it == page->keys[pos] && !values[i])
+            {
+                values[i] = page->values[pos];
+                remaining--;
+            }
+        }
+        current_index = page->overflow_entry_indices[pos];
+    }
+
+    record_chain_walk(visited_pages);
+}
+
+// Helper function to count a chain walk for the locality statistics
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::record_chain_walk(const std::vector<size_t> &visited_pages)
+{
+    if (visited_pages.empty())
+    {
+        return;
+    }
+    overflow_chain_walks++;
+    overflow_chain_walk_pages += visited_pages.size();
+}
+
+// Helper function to reacquire page of found entry, marked as dirty
+template <size_t BlockingFactor>
+typename BasicDatabase<BlockingFactor>::OverflowArea::PagePtr BasicDatabase<BlockingFactor>::get_page_for_write(const EntryLocation &location)
+{
+    return location.in_overflow_area ? overflow_area.get_page_for_write(location.page_index)
+                                     : main_area.get_page_for_write(location.page_index);
+}
+
+// Helper function to check the fill of overflow area, served from its header without reading any page
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::overflow_area_needs_reorganisation()
+{
+    const auto &header = overflow_area.get_header();
+    size_t capacity = header.number_of_pages * BLOCKING_FACTOR;
+    return header.number_of_entries >= capacity || static_cast<double>(header.number_of_entries) / capacity >= Settings::GAMMA;
+}
+
+// Helper function to pick the overflow page whose chains belong to a main area page.
+// Overflow pages are spread evenly over main area pages, guardian chain starts at the first one.
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::get_overflow_home_page(size_t entry_pos)
+{
+    if (entry_pos == -1ULL)
+    {
+        return 0;
+    }
+    return entry_pos * overflow_area.get_header().number_of_pages / main_area.get_header().number_of_pages;
+}
+
+// Helper function to find where a key is in an overflow chain, or where it would be inserted:
+// between a smaller key and the first key which is not smaller.
+template <size_t BlockingFactor>
+ChainPosition BasicDatabase<BlockingFactor>::find_in_overflow_chain(size_t start_index, uint64_t key)
+{
+    ChainPosition position;
+    position.current_index = start_index;
+    std::vector<size_t> visited_pages;
+
+    while (position.current_index != -1ULL)
+    {
+        auto current_page = overflow_area.get_page(position.current_index / BLOCKING_FACTOR);
+        size_t current_pos = position.current_index % BLOCKING_FACTOR;
+        if (std::find(visited_pages.begin(), visited_pages.end(), current_page->index) == visited_pages.end())
+        {
+            visited_pages.push_back(current_page->index);
+        }
+
+        if (current_page->keys[current_pos] >= key)
+        {
+            position.current_deleted = current_page->is_deleted(current_pos);
+            position.found = !position.current_deleted && current_page->keys[current_pos] == key;
+            break;
+        }
+
+        position.prev_index = position.current_index;
+        position.prev_deleted = current_page->is_deleted(current_pos);
+        position.current_index = current_page->overflow_entry_indices[current_pos];
+    }
+
+    record_chain_walk(visited_pages);
+    return position;
+}
+
+// Helper function to put a new entry into an overflow chain of the main area page at entry_pos, at a position found
+// by find_in_overflow_chain, which keeps the chain sorted. A deleted entry where the key belongs is reused. Otherwise the entry
+// goes to the page of its predecessor or successor in the chain, or the page closest to them with a free slot,
+// so a chain stays within as few pages as possible.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::insert_at_chain_position(uint64_t &start_index, size_t entry_pos, uint64_t key, uint64_t value, const ChainPosition &position)
+{
+    auto reuse_entry = [&](size_t entry_index)
+    {
+        auto page = overflow_area.get_page_for_write(entry_index / BLOCKING_FACTOR);
+        size_t pos = entry_index % BLOCKING_FACTOR;
+        page->keys[pos] = key;
+        page->values[pos] = value;
+        page->set_deleted(pos, false);
+    };
+
+    size_t prev_index = position.prev_index;
+    size_t current_index = position.current_index;
+    if (current_index != -1ULL && position.current_deleted)
+    {
+        reuse_entry(current_index);
+        return;
+    }
+    if (position.prev_deleted)
+    {
+        reuse_entry(prev_index);
+        return;
+    }
+
+    // Neighbours in the chain first, then whatever page with room is closest to them
+    size_t target_page = get_overflow_home_page(entry_pos);
+    if (prev_index != -1ULL)
+    {
+        target_page = prev_index / BLOCKING_FACTOR;
+    }
+    if (current_index != -1ULL && !free_space_map.has_room(target_page) && free_space_map.has_room(current_index / BLOCKING_FACTOR))
+    {
+        target_page = current_index / BLOCKING_FACTOR;
+    }
+    // A stale map can claim a full page has room, such a page is marked full and the next closest one is tried
+    size_t page_index;
+    size_t pos;
+    typename OverflowArea::PagePtr new_entry_page;
+    while (true)
+    {
+        page_index = free_space_map.find_nearest(target_page);
+        if (page_index == -1ULL)
+        {
+            throw std::runtime_error("Overflow area has no free slot");
+        }
+
+        new_entry_page = overflow_area.get_page_for_write(page_index);
+        pos = new_entry_page->find_free_slot();
+        if (pos != BLOCKING_FACTOR)
+        {
+            break;
+        }
+        free_space_map.set_has_room(page_index, false);
+    }
+    size_t new_entry_index = BLOCKING_FACTOR * page_index + pos;
+    new_entry_page->set_entry(pos, {key, value, current_index});
+    if (pos == new_entry_page->number_of_entries)
+    {
+        new_entry_page->number_of_entries++;
+    }
+    overflow_area.get_header().number_of_entries++;
+    overflow_chain_lengths[get_overflow_chain_counter(entry_pos)]++;
+    if (new_entry_page->find_free_slot() == BLOCKING_FACTOR)
+    {
+        free_space_map.set_has_room(page_index, false);
+    }
+
+    if (prev_index == -1ULL)
+    {
+        start_index = new_entry_index;
+    }
+    else
+    {
+        overflow_area.get_page_for_write(prev_index / BLOCKING_FACTOR)->overflow_entry_indices[prev_index % BLOCKING_FACTOR] = new_entry_index;
+    }
+}
+
+// Helper function to put a new entry into an overflow chain, walking it to find the position
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::insert_into_overflow_chain(uint64_t &start_index, size_t entry_pos, uint64_t key, uint64_t value)
+{
+    insert_at_chain_position(start_index, entry_pos, key, value, find_in_overflow_chain(start_index, key));
+}
+
+// Helper function to collect a chain which is about to be merged. Returns the entries which weren't deleted,
+// every slot of the chain, deleted entries included, is added to chain_slots.
+template <size_t BlockingFactor>
+std::vector<PageEntry> BasicDatabase<BlockingFactor>::take_overflow_chain(size_t start_index, std::vector<size_t> &chain_slots)
+{
+    std::vector<PageEntry> entries;
+    size_t current_index = start_index;
+    while (current_index != -1ULL)
+    {
+        auto page = overflow_area.get_page(current_index / BLOCKING_FACTOR);
+        auto entry = page->get_entry(current_index % BLOCKING_FACTOR);
+        if (!entry.was_deleted)
+        {
+            entries.push_back(entry);
+        }
+        chain_slots.push_back(current_index);
+        current_index = entry.overflow_entry_index;
+    }
+    return entries;
+}
+
+// Helper function to give slots back to their pages, in page order so every page is written once
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::reclaim_overflow_slots(std::vector<size_t> &slots)
+{
+    std::sort(slots.begin(), slots.end());
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        size_t page_index = slots[i] / BLOCKING_FACTOR;
+        overflow_area.prefetch(page_index + 1, Settings::READ_AHEAD_PAGES);
+        auto page = overflow_area.get_page_for_write(page_index);
+        for (; i < slots.size() && slots[i] / BLOCKING_FACTOR == page_index; ++i)
+        {
+            page->set_reclaimed(slots[i] % BLOCKING_FACTOR);
+            overflow_area.get_header().number_of_entries--;
+        }
+        --i;
+        free_space_map.set_has_room(page_index, true);
+    }
+}
+
+// Helper function to make room when an insert finds the overflow area full
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::reorganise_overflow_area()
+{
+    std::cout << "Overflow area is full, reorganising" << std::endl;
+    if (reorganisation_mode == ReorganisationMode::BACKGROUND)
+    {
+        start_background_reorganisation();
+        return;
+    }
+    // Rewriting everything sequentially is cheaper than merging most pages one by one
+    size_t main_pages = main_area.get_header().number_of_pages;
+    if (reorganisation_mode == ReorganisationMode::INCREMENTAL && count_damaged_pages() <= main_pages * Settings::INCREMENTAL_REORGANISATION_MAX_DAMAGE)
+    {
+        reorganise_incremental();
+        if (!overflow_area_needs_reorganisation())
+        {
+            return;
+        }
+    }
+    reorganise();
+}
+
+// Helper function to find which overflow pages have a free slot, when the sidecar file is missing
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::rebuild_free_space_map()
+{
+    free_space_map.reset(overflow_area.get_header().number_of_pages);
+    for (size_t i = 0; i < overflow_area.get_header().number_of_pages; ++i)
+    {
+        free_space_map.set_has_room(i, overflow_area.get_page(i)->find_free_slot() < BLOCKING_FACTOR);
+    }
+}
+
+// Helper function to tell whether incremental reorganisation merges the page of a chain length counter
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::is_damaged(size_t counter)
+{
+    return overflow_chain_lengths[counter] >= std::max<size_t>(1, Settings::DELTA * BLOCKING_FACTOR);
+}
+
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::count_damaged_pages()
+{
+    size_t damaged_pages = 0;
+    for (size_t i = 0; i < overflow_chain_lengths.size(); ++i)
+    {
+        damaged_pages += is_damaged(i);
+    }
+    return damaged_pages;
+}
+
+// Helper function to pick the chain length counter of a main area page, the last one belongs to the guardian
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::get_overflow_chain_counter(size_t entry_pos)
+{
+    return entry_pos == -1ULL ? overflow_chain_lengths.size() - 1 : entry_pos;
+}
+
+// Helper function to count the overflow entries of every main area page, when the sidecar file is missing
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::rebuild_overflow_chain_lengths()
+{
+    size_t number_of_pages = main_area.get_header().number_of_pages;
+    overflow_chain_lengths.assign(number_of_pages + 1, 0);
+
+    auto count_overflow_chain = [&](size_t counter, size_t current_index)
+    {
+        while (current_index != -1ULL)
+        {
+            overflow_chain_lengths[counter]++;
+            current_index = overflow_area.get_page(current_index / BLOCKING_FACTOR)->overflow_entry_indices[current_index % BLOCKING_FACTOR];
+        }
+    };
+
+    for (size_t i = 0; i < number_of_pages; ++i)
+    {
+        auto page = main_area.get_page(i);
+        for (size_t j = 0; j < page->number_of_entries; ++j)
+        {
+            count_overflow_chain(i, page->overflow_entry_indices[j]);
+        }
+    }
+    count_overflow_chain(number_of_pages, guardian.overflow_page_index);
+}
+
+// Helper function to find index position for a key. The resident level is served from memory,
+// every level below it costs one index page access.
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::find_index_position(uint64_t key)
+{
+    return find_index_range(key).entry_pos;
+}
+
+// Helper function to find index position for a key together with the start key of the next main area page.
+// Every level narrows the range, the entry after the chosen one bounds it unless the chosen one is the last.
+template <size_t BlockingFactor>
+IndexRange BasicDatabase<BlockingFactor>::find_index_range(uint64_t key)
+{
+    IndexRange range;
+    size_t position = sparse_index.find_position(key);
+    range.entry_pos = position == -1ULL ? -1ULL : sparse_index.get_page_index(position);
+    size_t next_position = position == -1ULL ? 0 : position + 1;
+    if (next_position < sparse_index.size())
+    {
+        range.end_key = sparse_index.get_start_key(next_position);
+    }
+    if (!sparse_index_holds_root())
+    {
+        return range;
+    }
+
+    for (size_t level = index_area.get_header().number_of_levels; level > 1 && range.entry_pos != -1ULL; --level)
+    {
+        // Parent fence key is the first start key of the page, so there is always an entry not greater than the key
+        auto index_page = index_area.get_page(range.entry_pos);
+        size_t i = 1;
+        while (i < index_page->number_of_entries && index_page->entries()[i].start_key <= key)
+        {
+            i++;
+        }
+        if (i < index_page->number_of_entries)
+        {
+            range.end_key = index_page->entries()[i].start_key;
+        }
+        range.entry_pos = index_page->entries()[i - 1].page_index;
+    }
+    return range;
+}
+
+// Helper function to find the leaf entry whose range holds the key, -1 if the key is smaller than every start key.
+// Leaf pages are full except the last one, so entry i of leaf page p is at position p * BLOCKING_FACTOR + i.
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::find_leaf_position(uint64_t key)
+{
+    if (!sparse_index_holds_root())
+    {
+        return sparse_index.find_position(key);
+    }
+
+    size_t position = sparse_index.find(key);
+
+    for (size_t level = index_area.get_header().number_of_levels; level > 1 && position != -1ULL; --level)
+    {
+        auto index_page = index_area.get_page(position);
+        size_t i = 1;
+        while (i < index_page->number_of_entries && index_page->entries()[i].start_key <= key)
+        {
+            i++;
+        }
+        // Pages above the leaf level point to leaf pages, which start the index area
+        position = level == 2 ? position * BLOCKING_FACTOR + i - 1 : index_page->entries()[i - 1].page_index;
+    }
+    return position;
+}
+
+// Helper function to fit the learned index over the current start keys and store it next to the index area
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::fit_learned_index()
+{
+    if (index_mode != IndexMode::LEARNED)
+    {
+        return;
+    }
+    sparse_index.fit_model(Settings::LEARNED_INDEX_MAX_ERROR);
+    sparse_index.save_model(std::string(Settings::LEARNED_INDEX_FILE_PATH));
+}
+
+// Helper function to pick the Bloom filter of a main area page, the last one belongs to the guardian
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::get_bloom_filter(size_t entry_pos)
+{
+    return entry_pos == -1ULL ? bloom_filters.size() - 1 : entry_pos;
+}
+
+// Helper function to fill the Bloom filters from the main and overflow area.
+// Deleted entries are added as well, filters only must not miss a key which can be found.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::rebuild_bloom_filters()
+{
+    size_t number_of_pages = main_area.get_header().number_of_pages;
+    bloom_filters.reset(number_of_pages + 1, BLOOM_FILTER_BITS);
+
+    auto add_overflow_chain = [&](size_t filter, size_t current_index)
+    {
+        while (current_index != -1ULL)
+        {
+            auto page = overflow_area.get_page(current_index / BLOCKING_FACTOR);
+            bloom_filters.add(filter, page->keys[current_index % BLOCKING_FACTOR]);
+            current_index = page->overflow_entry_indices[current_index % BLOCKING_FACTOR];
+        }
+    };
+
+    for (size_t i = 0; i < number_of_pages; ++i)
+    {
+        auto page = main_area.get_page(i);
+        for (size_t j = 0; j < page->number_of_entries; ++j)
+        {
+            bloom_filters.add(i, page->keys[j]);
+            add_overflow_chain(i, page->overflow_entry_indices[j]);
+        }
+    }
+    add_overflow_chain(number_of_pages, guardian.overflow_page_index);
+}
+
+// Helper function to save the Bloom filters, free space map and overflow chain lengths, stamped with
+// the generation of the main area header. Areas have to be flushed first, so the files describe what is on disk.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::save_sidecar_files()
+{
+    uint64_t generation = main_area.get_header().generation;
+    bloom_filters.save(std::string(Settings::BLOOM_FILTERS_FILE_PATH), generation);
+    free_space_map.save(std::string(Settings::OVERFLOW_FREE_SPACE_FILE_PATH), generation);
+    save_counters(std::string(Settings::OVERFLOW_CHAIN_LENGTHS_FILE_PATH), overflow_chain_lengths, generation);
+}
+
+// Helper function to move the header on disk past the generation of the saved sidecar files before pages can change,
+// if the process dies before they are saved again they no longer match it and are rebuilt when the database is opened
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::start_new_generation()
+{
+    main_area.get_header().generation++;
+    main_area.flush_header();
+}
+
+// Helper function to tell whether only the root of a multi-level index is resident.
+// Learned index models the leaf level, so in that mode the whole leaf level is kept in memory.
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::sparse_index_holds_root()
+{
+    return index_mode == IndexMode::BINARY_SEARCH && index_area.get_header().number_of_levels > 1;
+}
+
+// Helper function to read the resident level of the index area into the sparse index
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::load_sparse_index()
+{
+    const auto &header = index_area.get_header();
+    bool holds_root = sparse_index_holds_root();
+    size_t leaf_end = get_index_leaf_end(index_area);
+
+    size_t first_page = holds_root ? header.root_page_index : 0;
+    size_t last_page = holds_root ? header.root_page_index + 1 : leaf_end;
+    // Root entries point to index pages, leaf entries to main area pages
+    size_t number_of_targets = holds_root ? header.root_page_index : main_area.get_header().number_of_pages;
+
+    sparse_index.clear();
+    for (size_t page_idx = first_page; page_idx < last_page; page_idx++)
+    {
+        auto index_page = index_area.get_page(page_idx);
+        for (size_t i = 0; i < index_page->number_of_entries; i++)
+        {
+            const auto &entry = index_page->entries()[i];
+            if (entry.page_index >= number_of_targets)
+            {
+                throw std::runtime_error("Invalid page index in index entry");
+            }
+            sparse_index.append(entry.start_key, entry.page_index);
+        }
+    }
+}
+
+// Helper function to find where the leaf level ends, which is where level 1 begins.
+// It is found by following the first entries down from the root.
+template <size_t BlockingFactor>
+size_t BasicDatabase<BlockingFactor>::get_index_leaf_end(IndexArea &area)
+{
+    const auto &header = area.get_header();
+    if (header.number_of_levels == 1)
+    {
+        return header.number_of_pages;
+    }
+
+    size_t leaf_end = header.root_page_index;
+    for (size_t level = header.number_of_levels - 1; level > 1; --level)
+    {
+        leaf_end = area.get_page(leaf_end)->entries()[0].page_index;
+    }
+    return leaf_end;
+}
+
+// Helper function to get every leaf entry, which lists main area pages in key order.
+// Served from the sparse index when it holds the leaf level, only read below the root of a multi-level index.
+template <size_t BlockingFactor>
+std::vector<IndexEntry> BasicDatabase<BlockingFactor>::read_index_leaf_level(IndexArea &area)
+{
+    if (index_mode == IndexMode::LEARNED || area.get_header().number_of_levels == 1)
+    {
+        std::vector<IndexEntry> leaf_entries(sparse_index.size());
+        for (size_t i = 0; i < sparse_index.size(); ++i)
+        {
+            leaf_entries[i] = {sparse_index.get_start_key(i), sparse_index.get_page_index(i)};
+        }
+        return leaf_entries;
+    }
+
+    size_t leaf_end = get_index_leaf_end(area);
+    std::vector<IndexEntry> leaf_entries;
+    leaf_entries.reserve(leaf_end * BLOCKING_FACTOR);
+    for (size_t i = 0; i < leaf_end; ++i)
+    {
+        area.prefetch(i + 1, Settings::READ_AHEAD_PAGES);
+        auto index_page = area.get_page(i);
+        leaf_entries.insert(leaf_entries.end(), index_page->entries().begin(), index_page->entries().begin() + index_page->number_of_entries);
+    }
+    return leaf_entries;
+}
+
+// Helper function to write the leaf level from first_page on and every level above it, then fill the resident index.
+// Pages which already exist are overwritten, index only grows, so no page is left behind.
+// Upper levels are built when the leaf level has more than INDEX_TREE_MIN_LEAF_PAGES pages,
+// every entry holds the first start key of a page of the level below, the level which fits in a single page is the root.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::write_index_area(IndexArea &area, const std::vector<IndexEntry> &leaf_entries, size_t first_page, SparseIndex &resident_index)
+{
+    auto &header = area.get_header();
+    header.number_of_levels = 0;
+    header.root_page_index = 0;
+
+    std::vector<IndexEntry> level_entries = leaf_entries;
+    size_t level_begin = 0;
+    size_t write_from = first_page;
+    while (true)
+    {
+        size_t level_pages = std::max<size_t>(1, (level_entries.size() + BLOCKING_FACTOR - 1) / BLOCKING_FACTOR);
+        for (size_t i = write_from; i < level_pages; ++i)
+        {
+            size_t page_index = level_begin + i;
+            auto page = page_index < header.number_of_pages ? area.overwrite_page(page_index) : area.create_page();
+            size_t count = std::min(BLOCKING_FACTOR, level_entries.size() - i * BLOCKING_FACTOR);
+            std::copy_n(level_entries.begin() + i * BLOCKING_FACTOR, count, page->entries().begin());
+            page->number_of_entries = count;
+            // Finished page won't change anymore, write it while the next one is filled
+            page.release();
+            area.write_behind(page_index);
+        }
+        header.number_of_levels++;
+
+        if (level_pages == 1 || (header.number_of_levels == 1 && level_pages <= Settings::INDEX_TREE_MIN_LEAF_PAGES))
+        {
+            break;
+        }
+
+        std::vector<IndexEntry> upper_entries;
+        upper_entries.reserve(level_pages);
+        for (size_t i = 0; i < level_pages; ++i)
+        {
+            upper_entries.push_back({level_entries[i * BLOCKING_FACTOR].start_key, level_begin + i});
+        }
+        level_begin += level_pages;
+        level_entries = std::move(upper_entries);
+        write_from = 0;
+    }
+
+    // Only the root stays in memory, unless the learned index needs the leaf level
+    if (header.number_of_levels > 1)
+    {
+        header.root_page_index = level_begin;
+    }
+    const auto &resident_entries = header.number_of_levels > 1 && index_mode == IndexMode::BINARY_SEARCH ? level_entries : leaf_entries;
+    resident_index.clear();
+    for (const auto &entry : resident_entries)
+    {
+        resident_index.append(entry.start_key, entry.page_index);
+    }
+}
+
+template <size_t BlockingFactor>
+std::optional<EntryLocation> BasicDatabase<BlockingFactor>::search_for_entry(uint64_t key)
+{
+    auto entry_pos = find_index_position(key);
+
+    // Filter covers the page and every overflow chain hanging off it, a negative answer needs no reads
+    if (!bloom_filters.may_contain(get_bloom_filter(entry_pos), key))
+    {
+        absent_key_lookups++;
+        return std::nullopt;
+    }
+
+    auto location = search_from_index_position(entry_pos, key);
+    if (!location)
+    {
+        absent_key_lookups++;
+        bloom_filter_false_positives++;
+    }
+    return location;
+}
+
+template <size_t BlockingFactor>
+std::optional<EntryLocation> BasicDatabase<BlockingFactor>::search_from_index_position(size_t entry_pos, uint64_t key)
+{
+    // Check guardian if no index entry found
+    if (entry_pos == -1ULL)
+    {
+        return guardian.overflow_page_index == -1ULL ? std::nullopt : search_overflow_chain(guardian.overflow_page_index, key);
+    }
+
+    // Search in main area page. Keys are sorted and overflow chain of an entry only holds keys
+    // smaller than the next entry, so only the last entry not greater than the key has to be checked.
+    auto main_page = main_area.get_page(entry_pos);
+    size_t upper = main_page->find_first_greater(key);
+    if (upper == 0)
+    {
+        return std::nullopt;
+    }
+
+    size_t i = upper - 1;
+    if (main_page->is_deleted(i))
+    {
+        return std::nullopt;
+    }
+    if (main_page->keys[i] == key)
+    {
+        return EntryLocation{false, entry_pos, i};
+    }
+    if (main_page->overflow_entry_indices[i] != -1ULL)
+    {
+        return search_overflow_chain(main_page->overflow_entry_indices[i], key);
+    }
+    return std::nullopt;
+}
+
+// Helper function to look up sorted keys which all belong to one main area page, or to the guardian when entry_pos is -1.
+// Page is read once and every overflow chain at most once, for all the keys which end up in it.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::search_page_group(size_t entry_pos, std::span<const uint64_t> keys, std::span<std::optional<uint64_t>> values)
+{
+    if (entry_pos == -1ULL)
+    {
+        if (guardian.overflow_page_index != -1ULL)
+        {
+            search_overflow_chain(guardian.overflow_page_index, keys, values);
+        }
+        return;
+    }
+
+    auto main_page = main_area.get_page(entry_pos);
+    size_t first = 0;
+    while (first < keys.size())
+    {
+        // Same entry as in search_from_index_position, the last one not greater than the key
+        size_t upper = main_page->find_first_greater(keys[first]);
+        if (upper == 0 || main_page->is_deleted(upper - 1))
+        {
+            first++;
+            continue;
+        }
+
+        size_t i = upper - 1;
+        if (main_page->keys[i] == keys[first])
+        {
+            values[first] = main_page->values[i];
+            first++;
+            continue;
+        }
+
+        // Keys before the next entry all share the chain of this one
+        size_t last = first + 1;
+        while (last < keys.size() && (upper == main_page->number_of_entries || keys[last] < main_page->keys[upper]))
+        {
+            last++;
+        }
+        if (main_page->overflow_entry_indices[i] != -1ULL)
+        {
+            search_overflow_chain(main_page->overflow_entry_indices[i], keys.subspan(first, last - first), values.subspan(first, last - first));
+        }
+        first = last;
+    }
+}
+
+template <size_t BlockingFactor>
+BasicDatabase<BlockingFactor>::ReorganisationCursor::ReorganisationCursor(MainArea &main_area, OverflowArea &overflow_area, const std::vector<IndexEntry> &leaf_entries, size_t begin, size_t end, uint64_t guardian_start)
+    : main_area(main_area), overflow_area(overflow_area), leaf_entries(leaf_entries), leaf_position(begin), leaf_end(end), guardian_start(guardian_start)
+{
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::ReorganisationCursor::next(PageEntry &entry)
+{
+    while (true)
+    {
+        // Rest of the chain being walked, the page stays pinned while the chain stays on it
+        while (chain_position != -1ULL)
+        {
+            size_t page_index = chain_position / BLOCKING_FACTOR;
+            if (!overflow_page || overflow_page->index != page_index)
+            {
+                overflow_page.release();
+                overflow_page = overflow_area.get_page(page_index);
+            }
+            entry = overflow_page->get_entry(chain_position % BLOCKING_FACTOR);
+            chain_position = entry.overflow_entry_index;
+            if (!entry.was_deleted)
+            {
+                return true;
+            }
+        }
+
+        // Entry which waited for the guardian chain, its own chain follows it
+        if (pending_entry)
+        {
+            entry = *std::exchange(pending_entry, std::nullopt);
+            chain_position = entry.overflow_entry_index;
+            return true;
+        }
+
+        if (!main_page || entry_position == main_page->number_of_entries)
+        {
+            if (leaf_position == leaf_end)
+            {
+                main_page.release();
+                overflow_page.release();
+                return false;
+            }
+            // Keep reads of the following pages in flight while this one is processed
+            size_t page_index = leaf_entries[leaf_position++].page_index;
+            main_area.prefetch(page_index + 1, Settings::READ_AHEAD_PAGES);
+            main_page.release();
+            main_page = main_area.get_page(page_index);
+            entry_position = 0;
+            continue;
+        }
+
+        size_t position = entry_position++;
+        entry = main_page->get_entry(position);
+        if (entry.was_deleted)
+        {
+            continue;
+        }
+
+        // Guardian entries come first
+        if (leaf_position == 1 && position == 0)
+        {
+            pending_entry = entry;
+            chain_position = guardian_start;
+            continue;
+        }
+        chain_position = entry.overflow_entry_index;
+        return true;
+    }
+}
+
+template <size_t BlockingFactor>
+BasicDatabase<BlockingFactor>::ScanCursor::ScanCursor(BasicDatabase &database, uint64_t lo, uint64_t hi)
+    : database(database), lo(lo), hi(hi),
+      index_reader(database.index_area, 2),
+      // Pages read ahead, the one being handed out and the one before it
+      main_reader(database.main_area, Settings::SCAN_READ_AHEAD_PAGES + 2),
+      overflow_reader(database.overflow_area, Settings::SCAN_READ_AHEAD_PAGES + 1)
+{
+    if (lo > hi)
+    {
+        delta_position = delta_end = database.delta_buffer.end();
+        done = true;
+        return;
+    }
+    delta_position = database.delta_buffer.lower_bound(lo);
+    delta_end = database.delta_buffer.upper_bound(hi);
+
+    size_t position = database.find_leaf_position(lo);
+    if (position == -1ULL)
+    {
+        // Keys smaller than every start key are in the guardian chain
+        chain_position = database.guardian.overflow_page_index;
+        if (chain_position != -1ULL)
+        {
+            overflow_reader.prefetch(chain_position / BLOCKING_FACTOR);
+        }
+        position = 0;
+    }
+    if (database.sparse_index_holds_root())
+    {
+        leaf_end = database.get_index_leaf_end(database.index_area);
+    }
+    next_leaf_position = position;
+
+    if (advance_main_page() && chain_position == -1ULL)
+    {
+        // Chains of the entries before the last one not greater than lo only hold smaller keys
+        size_t upper = main_page->find_first_greater(lo);
+        entry_position = upper == 0 ? 0 : upper - 1;
+    }
+}
+
+template <size_t BlockingFactor>
+BasicDatabase<BlockingFactor>::ScanCursor::~ScanCursor()
+{
+    database.print_stats_after_operation(OperationType::SCAN);
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::ScanCursor::read_leaf_entry(IndexEntry &entry)
+{
+    if (!database.sparse_index_holds_root())
+    {
+        if (next_leaf_position == database.sparse_index.size())
+        {
+            return false;
+        }
+        entry = {database.sparse_index.get_start_key(next_leaf_position), database.sparse_index.get_page_index(next_leaf_position)};
+        next_leaf_position++;
+        return true;
+    }
+
+    // Leaf pages start the index area and are full except the last one
+    size_t page_index = next_leaf_position / BLOCKING_FACTOR;
+    size_t position = next_leaf_position % BLOCKING_FACTOR;
+    if (page_index == leaf_end)
+    {
+        return false;
+    }
+    if (position == 0 && page_index + 1 < leaf_end)
+    {
+        index_reader.prefetch(page_index + 1);
+    }
+    const auto &index_page = index_reader.get(page_index);
+    if (position == index_page.number_of_entries)
+    {
+        return false;
+    }
+    entry = index_page.entries()[position];
+    next_leaf_position++;
+    return true;
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::ScanCursor::advance_main_page()
+{
+    IndexEntry entry;
+    while (upcoming_pages.size() <= Settings::SCAN_READ_AHEAD_PAGES && read_leaf_entry(entry))
+    {
+        upcoming_pages.push_back(entry.page_index);
+        main_reader.prefetch(entry.page_index);
+    }
+    if (upcoming_pages.empty())
+    {
+        main_page = nullptr;
+        return false;
+    }
+
+    main_page = &main_reader.get(upcoming_pages.front());
+    upcoming_pages.pop_front();
+    entry_position = 0;
+
+    // Chains of the page are read while its entries are handed out
+    size_t prefetched = 0;
+    for (size_t i = 0; i < main_page->number_of_entries && main_page->keys[i] <= hi && prefetched < Settings::SCAN_READ_AHEAD_PAGES; ++i)
+    {
+        if (!main_page->is_deleted(i) && main_page->overflow_entry_indices[i] != -1ULL)
+        {
+            overflow_reader.prefetch(main_page->overflow_entry_indices[i] / BLOCKING_FACTOR);
+            prefetched++;
+        }
+    }
+    return true;
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::ScanCursor::next(uint64_t &key, uint64_t &value)
+{
+    while (true)
+    {
+        if (!area_pair)
+        {
+            uint64_t area_key;
+            uint64_t area_value;
+            if (next_in_areas(area_key, area_value))
+            {
+                area_pair = {area_key, area_value};
+            }
+        }
+
+        // Delta holds the newest value of its keys, or nothing when they were removed
+        if (delta_position != delta_end && (!area_pair || delta_position->first <= area_pair->first))
+        {
+            if (area_pair && delta_position->first == area_pair->first)
+            {
+                area_pair.reset();
+            }
+            auto [delta_key, delta_value] = *delta_position++;
+            if (!delta_value)
+            {
+                continue;
+            }
+            key = delta_key;
+            value = *delta_value;
+            return true;
+        }
+
+        if (!area_pair)
+        {
+            return false;
+        }
+        key = area_pair->first;
+        value = area_pair->second;
+        area_pair.reset();
+        return true;
+    }
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::ScanCursor::next_in_areas(uint64_t &key, uint64_t &value)
+{
+    while (!done)
+    {
+        // Chains are sorted and only hold keys between their entry and the next one
+        while (chain_position != -1ULL)
+        {
+            auto entry = overflow_reader.get(chain_position / BLOCKING_FACTOR).get_entry(chain_position % BLOCKING_FACTOR);
+            chain_position = entry.overflow_entry_index;
+            if (entry.was_deleted || entry.key < lo)
+            {
+                continue;
+            }
+            if (entry.key > hi)
+            {
+                done = true;
+                return false;
+            }
+            key = entry.key;
+            value = entry.value;
+            return true;
+        }
+
+        if (!main_page || entry_position == main_page->number_of_entries)
+        {
+            done = !advance_main_page();
+            continue;
+        }
+
+        size_t position = entry_position++;
+        // Search doesn't look past a deleted entry into its chain either
+        if (main_page->is_deleted(position))
+        {
+            continue;
+        }
+        if (main_page->keys[position] > hi)
+        {
+            done = true;
+            return false;
+        }
+        chain_position = main_page->overflow_entry_indices[position];
+        if (main_page->keys[position] >= lo)
+        {
+            key = main_page->keys[position];
+            value = main_page->values[position];
+            return true;
+        }
+    }
+    return false;
+}
+
+template <size_t BlockingFactor>
+std::optional<uint64_t> BasicDatabase<BlockingFactor>::search_wrapper(uint64_t key)
+{
+    // Writes made during background reorganisation are newer than the areas
+    if (auto it = delta_buffer.find(key); it != delta_buffer.end())
+    {
+        return it->second;
+    }
+
+    auto location = search_for_entry(key);
+    if (!location)
+    {
+        return std::nullopt;
+    }
+    auto page = location->in_overflow_area ? overflow_area.get_page(location->page_index)
+                                           : main_area.get_page(location->page_index);
+    return page->values[location->entry_pos];
+}
+
+template <size_t BlockingFactor>
+std::vector<std::optional<uint64_t>> BasicDatabase<BlockingFactor>::multi_search_wrapper(std::span<const uint64_t> keys)
+{
+    std::vector<std::optional<uint64_t>> results(keys.size());
+
+    // Distinct keys in ascending order, writes made during background reorganisation are answered from the delta
+    std::vector<uint64_t> sorted_keys;
+    sorted_keys.reserve(keys.size());
+    for (auto key : keys)
+    {
+        if (!delta_buffer.contains(key))
+        {
+            sorted_keys.push_back(key);
+        }
+    }
+    std::sort(sorted_keys.begin(), sorted_keys.end());
+    sorted_keys.erase(std::unique(sorted_keys.begin(), sorted_keys.end()), sorted_keys.end());
+    std::vector<std::optional<uint64_t>> sorted_values(sorted_keys.size());
+
+    // One index lookup per main area page, keys up to the start key of the next page go with the first one
+    std::vector<uint64_t> group_keys;
+    std::vector<std::optional<uint64_t>> group_values;
+    std::vector<size_t> group_positions;
+    size_t first = 0;
+    while (first < sorted_keys.size())
+    {
+        auto range = find_index_range(sorted_keys[first]);
+        size_t last = first + 1;
+        while (last < sorted_keys.size() && (!range.end_key || sorted_keys[last] < *range.end_key))
+        {
+            last++;
+        }
+
+        // Filter answers absent keys without reads, a group with no key left doesn't read its page
+        size_t filter = get_bloom_filter(range.entry_pos);
+        group_keys.clear();
+        group_positions.clear();
+        for (size_t i = first; i < last; ++i)
+        {
+            if (bloom_filters.may_contain(filter, sorted_keys[i]))
+            {
+                group_keys.push_back(sorted_keys[i]);
+                group_positions.push_back(i);
+            }
+            else
+            {
+                absent_key_lookups++;
+            }
+        }
+
+        if (!group_keys.empty())
+        {
+            group_values.assign(group_keys.size(), std::nullopt);
+            search_page_group(range.entry_pos, group_keys, group_values);
+            for (size_t i = 0; i < group_keys.size(); ++i)
+            {
+                if (!group_values[i])
+                {
+                    absent_key_lookups++;
+                    bloom_filter_false_positives++;
+                }
+                sorted_values[group_positions[i]] = group_values[i];
+            }
+        }
+        first = last;
+    }
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (auto it = delta_buffer.find(keys[i]); it != delta_buffer.end())
+        {
+            results[i] = it->second;
+            continue;
+        }
+        auto position = std::lower_bound(sorted_keys.begin(), sorted_keys.end(), keys[i]) - sorted_keys.begin();
+        results[i] = sorted_values[position];
+    }
+    return results;
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::print_wrapper()
+{
+    std::cout << "================================================" << std::endl;
+    std::cout << "Index area" << std::endl;
+    std::cout << "================================================" << std::endl;
+
+    // First page of every level, found by following the first entries down from the root
+    const auto &index_header = index_area.get_header();
+    std::vector<size_t> level_begin(index_header.number_of_levels + 1);
+    level_begin[index_header.number_of_levels] = index_header.number_of_pages;
+    level_begin[index_header.number_of_levels - 1] = index_header.root_page_index;
+    for (size_t level = index_header.number_of_levels - 1; level > 0; --level)
+    {
+        level_begin[level - 1] = index_area.get_page(level_begin[level])->entries()[0].page_index;
+    }
+
+    for (size_t level = 0; level < index_header.number_of_levels; ++level)
+    {
+        // Upper levels are only printed when the index has them
+        if (level > 0)
+        {
+            std::cout << "================================================" << std::endl;
+            std::cout << "Index level " << level << std::endl;
+            std::cout << "================================================" << std::endl;
+        }
+
+        for (size_t i = level_begin[level]; i < level_begin[level + 1]; ++i)
+        {
+            auto page = index_area.get_page(i);
+            std::cout << "Page " << i << " number of entries: " << page->number_of_entries << std::endl;
+            for (size_t j = 0; j < page->number_of_entries; ++j)
+            {
+                std::cout << "\tEntry " << j << "\n\t\tstart_key: " << page->entries()[j].start_key
+                          << "\n\t\tpage_index: " << page->entries()[j].page_index << std::endl;
+            }
+        }
+    }
+
+    std::cout << "================================================" << std::endl;
+    std::cout << "Main area" << std::endl;
+    std::cout << "================================================" << std::endl;
+
+    std::cout << "Guardian overflow page index: " << (guardian.overflow_page_index == -1ULL ? "null" : std::to_string(guardian.overflow_page_index)) << '\n'
+              << std::endl;
+
+    for (size_t i = 0; i < main_area.get_header().number_of_pages; ++i)
+    {
+        auto page = main_area.get_page(i);
+        std::cout << "Page " << i << " number of entries: " << page->number_of_entries << std::endl;
+        for (size_t j = 0; j < page->number_of_entries; ++j)
+        {
+            auto entry = page->get_entry(j);
+            std::cout << "\tEntry " << j << "\n\t\tkey: " << entry.key
+                      << "\n\t\tvalue: " << entry.value
+                      << "\n\t\toverflow_entry_index: "
+                      << (entry.overflow_entry_index == -1ULL ? "null" : std::to_string(entry.overflow_entry_index))
+                      << (entry.was_deleted ? "\n\t\tdeleted: true" : "") << std::endl;
+        }
+    }
+
+    std::cout << "================================================" << std::endl;
+    std::cout << "Overflow area" << std::endl;
+    std::cout << "================================================" << std::endl;
+
+    for (size_t i = 0; i < overflow_area.get_header().number_of_pages; ++i)
+    {
+        auto page = overflow_area.get_page(i);
+        std::cout << "Page " << i << " number of entries: " << page->number_of_entries << std::endl;
+        for (size_t j = 0; j < page->number_of_entries; ++j)
+        {
+            auto entry = page->get_entry(j);
+            std::cout << "\tEntry " << j << "\n\t\tkey: " << entry.key
+                      << "\n\t\tvalue: " << entry.value
+                      << "\n\t\toverflow_entry_index: " << (entry.overflow_entry_index == -1ULL ? "null" : std::to_string(entry.overflow_entry_index))
+                      << (entry.was_deleted ? "\n\t\tdeleted: true" : "") << std::endl;
+        }
+    }
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::insert_wrapper(uint64_t key, uint64_t value)
+{
+    if (search_wrapper(key))
+    {
+        throw std::runtime_error("Key already exists");
+    }
+    if (buffer_write(key, value))
+    {
+        return;
+    }
+
+    auto entry_pos = find_index_position(key);
+    bloom_filters.add(get_bloom_filter(entry_pos), key);
+
+    // Handle insertion into guardian (overflow area)
+    if (entry_pos == -1ULL)
+    {
+        // If overflow area is full, reorganise and try again
+        if (overflow_area_needs_reorganisation())
+        {
+            reorganise_overflow_area();
+            return insert(key, value);
+        }
+
+        insert_into_overflow_chain(guardian.overflow_page_index, entry_pos, key, value);
+        return;
+    }
+
+    // Handle first insert into index root
+    if (sparse_index.get_start_key(0) == 0)
+    {
+        auto index_page = index_area.get_page_for_write(0);
+        index_page->entries()[0] = {key, 0};
+        index_page->number_of_entries = 1;
+
+        sparse_index.clear();
+        sparse_index.append(key, 0);
+        fit_learned_index();
+    }
+
+    // Insert into main area page
+    auto main_page = main_area.get_page(entry_pos);
+    size_t insert_pos = -1ULL;
+
+    size_t upper = main_page->find_first_greater(key);
+    if (upper < main_page->number_of_entries)
+    {
+        insert_pos = upper - 1;
+    }
+
+    // Insert as last record if possible
+    if (insert_pos == -1ULL)
+    {
+        if (main_page->number_of_entries < BLOCKING_FACTOR)
+        {
+            auto writable_main_page = main_area.get_page_for_write(entry_pos);
+            writable_main_page->set_entry(writable_main_page->number_of_entries, {key, value, -1ULL});
+            writable_main_page->number_of_entries++;
+            return;
+        }
+        else
+        {
+            // Insert in overflow, when main area is full
+            insert_pos = main_page->number_of_entries - 1;
+        }
+    }
+
+    // Insert into overflow area
+    if (overflow_area_needs_reorganisation())
+    {
+        // Reorganisation replaces the buffers, nothing may stay pinned
+        main_page.release();
+        reorganise_overflow_area();
+        return insert(key, value);
+    }
+
+    auto writable_main_page = main_area.get_page_for_write(entry_pos);
+    insert_into_overflow_chain(writable_main_page->overflow_entry_indices[insert_pos], entry_pos, key, value);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::update_wrapper(uint64_t key, uint64_t value)
+{
+    if (background_reorganisation.valid() && !search_wrapper(key))
+    {
+        return;
+    }
+    if (buffer_write(key, value))
+    {
+        return;
+    }
+
+    auto location = search_for_entry(key);
+    if (!location)
+    {
+        return;
+    }
+    auto page = get_page_for_write(*location);
+    page->values[location->entry_pos] = value;
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::remove_wrapper(uint64_t key)
+{
+    if (background_reorganisation.valid() && !search_wrapper(key))
+    {
+        return;
+    }
+    if (buffer_write(key, std::nullopt))
+    {
+        return;
+    }
+
+    auto location = search_for_entry(key);
+    if (!location)
+    {
+        return;
+    }
+
+    auto page = get_page_for_write(*location);
+    page->set_deleted(location->entry_pos);
+}
+
+// Finds the key the way search does and, when the condition holds, writes it in the same pass.
+// Main area page is read once and the chain which holds the key, or would get it, is walked once.
+// A new key goes where insert would put it.
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::conditional_write(uint64_t key, uint64_t value, WriteCondition condition, uint64_t expected)
+{
+    auto holds = [&](std::optional<uint64_t> current)
+    {
+        switch (condition)
+        {
+        case WriteCondition::IF_ABSENT:
+            return !current;
+        case WriteCondition::IF_EQUAL:
+            return current == expected;
+        default:
+            return true;
+        }
+    };
+
+    // Old areas are only read while background reorganisation runs
+    if (background_reorganisation.valid())
+    {
+        if (!holds(search_wrapper(key)))
+        {
+            return false;
+        }
+        if (buffer_write(key, value))
+        {
+            return true;
+        }
+    }
+
+    auto entry_pos = find_index_position(key);
+    // Filter rules out a key without reading its chain, the chain is then only walked to insert into it
+    bool may_contain = bloom_filters.may_contain(get_bloom_filter(entry_pos), key);
+    if (!may_contain && !holds(std::nullopt))
+    {
+        absent_key_lookups++;
+        return false;
+    }
+
+    if (entry_pos == -1ULL)
+    {
+        auto position = find_in_overflow_chain(guardian.overflow_page_index, key);
+        if (position.found)
+        {
+            auto page = overflow_area.get_page(position.current_index / BLOCKING_FACTOR);
+            if (!holds(page->values[position.current_index % BLOCKING_FACTOR]))
+            {
+                return false;
+            }
+            page.release();
+            overflow_area.get_page_for_write(position.current_index / BLOCKING_FACTOR)->values[position.current_index % BLOCKING_FACTOR] = value;
+            return true;
+        }
+        absent_key_lookups++;
+        bloom_filter_false_positives += may_contain;
+        if (!holds(std::nullopt))
+        {
+            return false;
+        }
+
+        bloom_filters.add(get_bloom_filter(entry_pos), key);
+        if (overflow_area_needs_reorganisation())
+        {
+            reorganise_overflow_area();
+            return conditional_write(key, value, condition, expected);
+        }
+        insert_at_chain_position(guardian.overflow_page_index, entry_pos, key, value, position);
+        return true;
+    }
+
+    auto main_page = main_area.get_page(entry_pos);
+    size_t upper = main_page->find_first_greater(key);
+    size_t last_not_greater = upper - 1;
+    bool live_entry = upper > 0 && !main_page->is_deleted(last_not_greater);
+    if (live_entry && main_page->keys[last_not_greater] == key)
+    {
+        if (!holds(main_page->values[last_not_greater]))
+        {
+            return false;
+        }
+        main_area.get_page_for_write(entry_pos)->values[last_not_greater] = value;
+        return true;
+    }
+
+    // Search only follows the chain of a live entry
+    std::optional<ChainPosition> position;
+    if (may_contain && live_entry && main_page->overflow_entry_indices[last_not_greater] != -1ULL)
+    {
+        position = find_in_overflow_chain(main_page->overflow_entry_indices[last_not_greater], key);
+        if (position->found)
+        {
+            auto page = overflow_area.get_page(position->current_index / BLOCKING_FACTOR);
+            if (!holds(page->values[position->current_index % BLOCKING_FACTOR]))
+            {
+                return false;
+            }
+            page.release();
+            overflow_area.get_page_for_write(position->current_index / BLOCKING_FACTOR)->values[position->current_index % BLOCKING_FACTOR] = value;
+            return true;
+        }
+    }
+    absent_key_lookups++;
+    bloom_filter_false_positives += may_contain;
+    if (!holds(std::nullopt))
+    {
+        return false;
+    }
+
+    // Key is new, from here on the same as insert
+    bloom_filters.add(get_bloom_filter(entry_pos), key);
+    if (sparse_index.get_start_key(0) == 0)
+    {
+        auto index_page = index_area.get_page_for_write(0);
+        index_page->entries()[0] = {key, 0};
+        index_page->number_of_entries = 1;
+
+        sparse_index.clear();
+        sparse_index.append(key, 0);
+        fit_learned_index();
+    }
+
+    size_t insert_pos = upper < main_page->number_of_entries ? upper - 1 : -1ULL;
+    if (insert_pos == -1ULL)
+    {
+        if (main_page->number_of_entries < BLOCKING_FACTOR)
+        {
+            auto writable_main_page = main_area.get_page_for_write(entry_pos);
+            writable_main_page->set_entry(writable_main_page->number_of_entries, {key, value, -1ULL});
+            writable_main_page->number_of_entries++;
+            return true;
+        }
+        insert_pos = main_page->number_of_entries - 1;
+    }
+
+    if (overflow_area_needs_reorganisation())
+    {
+        // Reorganisation replaces the buffers, nothing may stay pinned
+        main_page.release();
+        reorganise_overflow_area();
+        return conditional_write(key, value, condition, expected);
+    }
+
+    auto writable_main_page = main_area.get_page_for_write(entry_pos);
+    // Chain wasn't walked above when it hangs off a deleted entry or the filter ruled the key out
+    if (insert_pos != last_not_greater || !position)
+    {
+        position = find_in_overflow_chain(writable_main_page->overflow_entry_indices[insert_pos], key);
+    }
+    insert_at_chain_position(writable_main_page->overflow_entry_indices[insert_pos], entry_pos, key, value, *position);
+    return true;
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::reorganise_wrapper()
+{
+    finish_background_reorganisation();
+
+    auto areas = build_reorganised_areas(index_area, main_area, overflow_area, guardian.overflow_page_index);
+    install_reorganised_areas(areas);
+}
+
+// Builds reorganised copies of the given areas in the temporary files, merging in sorted additions if there are any.
+// Only reads the source areas and members which don't change while it runs, so it can run on another thread over a snapshot.
+template <size_t BlockingFactor>
+typename BasicDatabase<BlockingFactor>::ReorganisedAreas BasicDatabase<BlockingFactor>::build_reorganised_areas(IndexArea &source_index_area, MainArea &source_main_area, OverflowArea &source_overflow_area, uint64_t guardian_start, KeyValueSource *additions)
+{
+    ReorganisedAreas areas;
+    // Source areas may be read-only snapshots, new ones replace them
+    areas.index_area = std::make_unique<IndexArea>(Settings::TEMP_INDEX_FILE_PATH, true, with_read_only(source_index_area.get_options(), false));
+    areas.main_area = std::make_unique<MainArea>(Settings::TEMP_MAIN_FILE_PATH, true, with_read_only(source_main_area.get_options(), false));
+    areas.overflow_area = std::make_unique<OverflowArea>(Settings::TEMP_OVERFLOW_FILE_PATH, true, with_read_only(source_overflow_area.get_options(), false));
+    auto &new_main_area = *areas.main_area;
+    // Sidecar files saved before aren't valid for the new files either
+    new_main_area.get_header().generation = source_main_area.get_header().generation;
+
+    // Filter and leaf entry of a new page are made once it is full, the guardian filter stays last
+    areas.bloom_filters.reset(1, BLOOM_FILTER_BITS);
+    std::vector<IndexEntry> new_leaf_entries;
+    typename MainArea::PagePtr current_main_page;
+    auto finish_main_page = [&]()
+    {
+        size_t page_index = current_main_page->index;
+        areas.bloom_filters.insert_empty(page_index, 1);
+        for (size_t j = 0; j < current_main_page->number_of_entries; ++j)
+        {
+            areas.bloom_filters.add(page_index, current_main_page->keys[j]);
+        }
+        new_leaf_entries.push_back({current_main_page->keys[0], page_index});
+    };
+
+    // New pages are filled in place and written in large extents, a full page is only replaced when there is another entry for it
+    new_main_area.start_appending();
+    current_main_page = new_main_area.create_page();
+    auto append_entry = [&](const PageEntry &entry)
+    {
+        if (current_main_page->number_of_entries == ENTRIES_AFTER_REORGANISATION)
+        {
+            finish_main_page();
+            current_main_page = new_main_area.create_page();
+        }
+        current_main_page->set_entry(current_main_page->number_of_entries, entry);
+        current_main_page->overflow_entry_indices[current_main_page->number_of_entries] = -1ULL;
+        current_main_page->number_of_entries++;
+    };
+
+    // Additions go in front of the first entry with a greater key, keys which already exist are skipped
+    PageEntry addition;
+    bool has_addition = false;
+    size_t skipped_additions = 0;
+    auto next_addition = [&]()
+    {
+        uint64_t previous_key = addition.key;
+        bool had_addition = has_addition;
+        while ((has_addition = additions && additions->next(addition.key, addition.value)) && had_addition && addition.key == previous_key)
+        {
+            skipped_additions++;
+        }
+        if (has_addition && had_addition && addition.key < previous_key)
+        {
+            throw std::runtime_error("Bulk load input is not sorted");
+        }
+    };
+    auto append_additions_before = [&](const PageEntry *entry)
+    {
+        while (has_addition && (!entry || addition.key <= entry->key))
+        {
+            if (entry && addition.key == entry->key)
+            {
+                skipped_additions++;
+            }
+            else
+            {
+                append_entry({addition.key, addition.value, -1ULL, 0});
+            }
+            next_addition();
+        }
+    };
+    next_addition();
+
+    // Setup main area, pages are visited in key order, incremental reorganisation appends pages out of order
+
+    auto leaf_entries = read_index_leaf_level(source_index_area);
+
+    size_t number_of_partitions = (leaf_entries.size() + Settings::REORGANISATION_PARTITION_PAGES - 1) / Settings::REORGANISATION_PARTITION_PAGES;
+    size_t number_of_threads = Settings::REORGANISATION_THREADS ? Settings::REORGANISATION_THREADS : std::thread::hardware_concurrency();
+    if (number_of_partitions < 2 || number_of_threads < 2)
+    {
+        // Entries go straight from the source pages to the new ones
+        ReorganisationCursor cursor(source_main_area, source_overflow_area, leaf_entries, 0, leaf_entries.size(), guardian_start);
+        PageEntry entry;
+        while (cursor.next(entry))
+        {
+            append_additions_before(&entry);
+            append_entry(entry);
+        }
+    }
+    else
+    {
+        // Workers read the files, pages still cached by the source buffers have to be there
+        source_main_area.flush();
+        source_overflow_area.flush();
+        // Other workers and the source buffers have the same files open, workers never write to them
+        auto main_options = with_read_only(source_main_area.get_options(), true);
+        auto overflow_options = with_read_only(source_overflow_area.get_options(), true);
+        main_options.number_of_frames = Settings::DEFAULT_PAGE_BUFFER_SIZE;
+        overflow_options.number_of_frames = Settings::DEFAULT_PAGE_BUFFER_SIZE;
+
+        struct Partition
+        {
+            std::vector<PageEntry> entries;
+            size_t main_reads;
+            size_t overflow_reads;
+        };
+
+        // A fixed set of workers opens the files once and takes key ranges in order until none is left,
+        // ranges are appended in key order and at most one range per worker waits for the writer
+        size_t number_of_workers = std::min(number_of_threads, number_of_partitions);
+        std::vector<std::optional<Partition>> partitions(number_of_partitions);
+        std::mutex mutex;
+        std::condition_variable partition_done;
+        std::condition_variable partition_taken;
+        size_t next_partition = 0;
+        size_t next_to_append = 0;
+        bool stopping = false;
+        std::exception_ptr worker_error;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                MainArea worker_main_area(Settings::MAIN_FILE_PATH, false, main_options);
+                OverflowArea worker_overflow_area(Settings::OVERFLOW_FILE_PATH, false, overflow_options);
+                while (true)
+                {
+                    size_t index;
+                    {
+                        std::unique_lock lock(mutex);
+                        partition_taken.wait(lock, [&]
+                                             { return stopping || next_partition == number_of_partitions || next_partition < next_to_append + number_of_workers; });
+                        if (stopping || next_partition == number_of_partitions)
+                        {
+                            return;
+                        }
+                        index = next_partition++;
+                    }
+
+                    size_t begin = index * Settings::REORGANISATION_PARTITION_PAGES;
+                    size_t end = std::min(begin + Settings::REORGANISATION_PARTITION_PAGES, leaf_entries.size());
+                    size_t main_reads = worker_main_area.get_read_count();
+                    size_t overflow_reads = worker_overflow_area.get_read_count();
+                    Partition partition;
+                    ReorganisationCursor cursor(worker_main_area, worker_overflow_area, leaf_entries, begin, end, guardian_start);
+                    PageEntry entry;
+                    while (cursor.next(entry))
+                    {
+                        partition.entries.push_back(entry);
+                    }
+                    partition.main_reads = worker_main_area.get_read_count() - main_reads;
+                    partition.overflow_reads = worker_overflow_area.get_read_count() - overflow_reads;
+
+                    {
+                        std::lock_guard lock(mutex);
+                        partitions[index] = std::move(partition);
+                    }
+                    partition_done.notify_all();
+                }
+            }
+            catch (...)
+            {
+                {
+                    std::lock_guard lock(mutex);
+                    worker_error = std::current_exception();
+                    stopping = true;
+                }
+                partition_done.notify_all();
+                partition_taken.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        auto stop_workers = [&]()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+            }
+            partition_taken.notify_all();
+            for (auto &thread : workers)
+            {
+                thread.join();
+            }
+        };
+
+        try
+        {
+            for (size_t i = 0; i < number_of_workers; ++i)
+            {
+                workers.emplace_back(worker);
+            }
+            for (size_t index = 0; index < number_of_partitions; ++index)
+            {
+                Partition partition;
+                {
+                    std::unique_lock lock(mutex);
+                    partition_done.wait(lock, [&]
+                                        { return partitions[index] || worker_error; });
+                    if (!partitions[index])
+                    {
+                        std::rethrow_exception(worker_error);
+                    }
+                    partition = std::move(*partitions[index]);
+                    partitions[index].reset();
+                    next_to_append++;
+                }
+                partition_taken.notify_all();
+
+                for (const auto &entry : partition.entries)
+                {
+                    append_additions_before(&entry);
+                    append_entry(entry);
+                }
+                source_main_area.add_read_count(partition.main_reads);
+                source_overflow_area.add_read_count(partition.overflow_reads);
+            }
+        }
+        catch (...)
+        {
+            stop_workers();
+            throw;
+        }
+        stop_workers();
+    }
+    append_additions_before(nullptr);
+    if (skipped_additions > 0)
+    {
+        DEBUG_CERR << "Bulk load skipped " << skipped_additions << " keys which already exist" << std::endl;
+    }
+    finish_main_page();
+    current_main_page.release();
+    new_main_area.finish_appending();
+
+    // Setup index area, overflow area is empty after reorganisation
+    areas.index_area->start_appending();
+    write_index_area(*areas.index_area, new_leaf_entries, 0, areas.sparse_index);
+    areas.index_area->finish_appending();
+    if (index_mode == IndexMode::LEARNED)
+    {
+        areas.sparse_index.fit_model(Settings::LEARNED_INDEX_MAX_ERROR);
+    }
+
+    // Create pages for overflow area
+    size_t overflow_pages = std::max<size_t>(1, std::ceil(new_main_area.get_header().number_of_pages * Settings::BETA));
+    areas.overflow_area->start_appending();
+    for (size_t i = 0; i < overflow_pages; ++i)
+    {
+        areas.overflow_area->create_page();
+    }
+    areas.overflow_area->finish_appending();
+
+    return areas;
+}
+
+// Helper function to replace the areas with reorganised ones, guardian chain was merged into the main area
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::install_reorganised_areas(ReorganisedAreas &areas)
+{
+    guardian.overflow_page_index = -1ULL;
+
+    index_area = std::move(*areas.index_area);
+    main_area = std::move(*areas.main_area);
+    overflow_area = std::move(*areas.overflow_area);
+    sparse_index = std::move(areas.sparse_index);
+    if (index_mode == IndexMode::LEARNED)
+    {
+        sparse_index.save_model(std::string(Settings::LEARNED_INDEX_FILE_PATH));
+    }
+    bloom_filters = std::move(areas.bloom_filters);
+    free_space_map.reset(overflow_area.get_header().number_of_pages);
+    overflow_chain_lengths.assign(main_area.get_header().number_of_pages + 1, 0);
+}
+
+// Starts reorganisation on another thread. Files are flushed first and serve as its snapshot,
+// until the new areas are installed the old ones are only read and writes go to the delta buffer.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::start_background_reorganisation()
+{
+    index_area.flush();
+    main_area.flush();
+    overflow_area.flush();
+
+    // Foreground keeps the files, the snapshot never writes to them, not even their headers
+    auto index_options = with_read_only(index_area.get_options(), true);
+    auto main_options = with_read_only(main_area.get_options(), true);
+    auto overflow_options = with_read_only(overflow_area.get_options(), true);
+    uint64_t guardian_start = guardian.overflow_page_index;
+    background_reorganisation = std::async(std::launch::async, [this, index_options, main_options, overflow_options, guardian_start]()
+                                           {
+        // Separate buffers over the same files, the foreground keeps its own
+        IndexArea snapshot_index_area(Settings::INDEX_FILE_PATH, false, index_options);
+        MainArea snapshot_main_area(Settings::MAIN_FILE_PATH, false, main_options);
+        OverflowArea snapshot_overflow_area(Settings::OVERFLOW_FILE_PATH, false, overflow_options);
+
+        auto areas = build_reorganised_areas(snapshot_index_area, snapshot_main_area, snapshot_overflow_area, guardian_start);
+        // Asynchronous I/O of this thread has to be done before the buffers change hands
+        areas.index_area->flush();
+        areas.main_area->flush();
+        areas.overflow_area->flush();
+        return areas; });
+}
+
+// Helper function to wait for reorganisation running in the background, install its areas and replay
+// writes made in the meantime. Replayed inserts may start the next one, which is waited for as well.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::finish_background_reorganisation()
+{
+    while (background_reorganisation.valid())
+    {
+        // When it failed the old areas are intact, writes are replayed into them
+        std::exception_ptr error;
+        try
+        {
+            auto areas = background_reorganisation.get();
+            install_reorganised_areas(areas);
+        }
+        catch (const std::exception &)
+        {
+            error = std::current_exception();
+        }
+
+        for (const auto &[key, value] : std::exchange(delta_buffer, {}))
+        {
+            if (!value)
+            {
+                remove_wrapper(key);
+            }
+            else if (search_wrapper(key))
+            {
+                update_wrapper(key, *value);
+            }
+            else
+            {
+                insert_wrapper(key, *value);
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+// Helper function to keep a write while reorganisation runs in the background, empty value removes the key.
+// Returns false when there is no reorganisation running, the write then goes to the areas.
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::buffer_write(uint64_t key, std::optional<uint64_t> value)
+{
+    if (background_reorganisation.valid() && delta_buffer.size() >= Settings::BACKGROUND_REORGANISATION_MAX_DELTA)
+    {
+        finish_background_reorganisation();
+    }
+    if (!background_reorganisation.valid())
+    {
+        return false;
+    }
+    delta_buffer[key] = value;
+    return true;
+}
+
+// Merges only main area pages whose overflow chains hold at least DELTA * blocking factor entries.
+// Live entries of such a page and its chains are split at ALPHA fill, the first part stays in the page,
+// the rest go to new pages at the end of main area. Slots of the merged chains are reclaimed.
+// Leaf level is read to find the pages in key order, only index pages from the first new entry on are written.
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::reorganise_incremental_wrapper()
+{
+    finish_background_reorganisation();
+
+    size_t number_of_pages = main_area.get_header().number_of_pages;
+
+    std::vector<bool> damaged(number_of_pages);
+    bool merge_guardian = is_damaged(number_of_pages);
+    bool any_damaged = merge_guardian;
+    for (size_t i = 0; i < number_of_pages; ++i)
+    {
+        damaged[i] = is_damaged(i);
+        any_damaged |= damaged[i];
+    }
+    if (!any_damaged)
+    {
+        return;
+    }
+
+    auto leaf_entries = read_index_leaf_level(index_area);
+    // Guardian chain is merged into the first page, its keys are smaller than every start key
+    if (merge_guardian)
+    {
+        damaged[leaf_entries[0].page_index] = true;
+    }
+
+    std::vector<IndexEntry> new_leaf_entries;
+    new_leaf_entries.reserve(leaf_entries.size());
+    size_t first_changed_entry = -1ULL;
+    std::vector<size_t> reclaimed_slots;
+    // Keys of the new pages, their filters are created once all of them exist
+    std::vector<std::pair<size_t, uint64_t>> new_page_keys;
+
+    for (size_t i = 0; i < leaf_entries.size(); ++i)
+    {
+        IndexEntry index_entry = leaf_entries[i];
+        if (!damaged[index_entry.page_index])
+        {
+            new_leaf_entries.push_back(index_entry);
+            continue;
+        }
+
+        // Same entries full reorganisation keeps, a deleted main entry takes its chain with it
+        std::vector<PageEntry> all_entries;
+        if (i == 0 && merge_guardian)
+        {
+            all_entries = take_overflow_chain(guardian.overflow_page_index, reclaimed_slots);
+            guardian.overflow_page_index = -1ULL;
+        }
+
+        auto page = main_area.get_page_for_write(index_entry.page_index);
+        PageEntry first_main_entry = page->get_entry(0);
+        for (size_t j = 0; j < page->number_of_entries; ++j)
+        {
+            auto entry = page->get_entry(j);
+            auto overflow_entries = take_overflow_chain(entry.overflow_entry_index, reclaimed_slots);
+            if (!entry.was_deleted)
+            {
+                all_entries.push_back(entry);
+                all_entries.insert(all_entries.end(), overflow_entries.begin(), overflow_entries.end());
+            }
+        }
+        overflow_chain_lengths[index_entry.page_index] = 0;
+        bloom_filters.clear(index_entry.page_index);
+
+        // Inserts expect the first key of a page to be its start key. A page left without live entries
+        // keeps its first entry deleted, like a page whose entries were all removed.
+        if (all_entries.empty())
+        {
+            all_entries.push_back(first_main_entry);
+        }
+        if (all_entries[0].key != index_entry.start_key)
+        {
+            index_entry.start_key = all_entries[0].key;
+            first_changed_entry = std::min(first_changed_entry, new_leaf_entries.size());
+        }
+        new_leaf_entries.push_back(index_entry);
+
+        // First part stays in the page
+        size_t page_index = index_entry.page_index;
+        *page = Page<BlockingFactor>();
+        page->index = page_index;
+        size_t count = std::min(ENTRIES_AFTER_REORGANISATION, all_entries.size());
+        for (size_t j = 0; j < count; ++j)
+        {
+            page->set_entry(j, all_entries[j]);
+            page->overflow_entry_indices[j] = -1ULL;
+            bloom_filters.add(page_index, all_entries[j].key);
+        }
+        page->number_of_entries = count;
+        page.release();
+
+        for (size_t first = count; first < all_entries.size(); first += ENTRIES_AFTER_REORGANISATION)
+        {
+            auto new_page = main_area.create_page();
+            count = std::min(ENTRIES_AFTER_REORGANISATION, all_entries.size() - first);
+            for (size_t j = 0; j < count; ++j)
+            {
+                new_page->set_entry(j, all_entries[first + j]);
+                new_page->overflow_entry_indices[j] = -1ULL;
+                new_page_keys.push_back({new_page->index, all_entries[first + j].key});
+            }
+            new_page->number_of_entries = count;
+
+            first_changed_entry = std::min(first_changed_entry, new_leaf_entries.size());
+            new_leaf_entries.push_back({all_entries[first].key, new_page->index});
+        }
+    }
+
+    reclaim_overflow_slots(reclaimed_slots);
+
+    // Counters and filters of the new pages go in front of the guardian's
+    size_t new_pages = main_area.get_header().number_of_pages - number_of_pages;
+    bloom_filters.insert_empty(number_of_pages, new_pages);
+    overflow_chain_lengths.insert(overflow_chain_lengths.begin() + number_of_pages, new_pages, 0);
+    if (merge_guardian)
+    {
+        bloom_filters.clear(bloom_filters.size() - 1);
+        overflow_chain_lengths.back() = 0;
+    }
+    for (const auto &[page_index, key] : new_page_keys)
+    {
+        bloom_filters.add(page_index, key);
+    }
+
+    // Overflow area keeps BETA pages per main area page, like after full reorganisation
+    for (size_t i = overflow_area.get_header().number_of_pages; i < std::ceil(main_area.get_header().number_of_pages * Settings::BETA); ++i)
+    {
+        overflow_area.create_page();
+    }
+    free_space_map.grow(overflow_area.get_header().number_of_pages);
+
+    if (first_changed_entry != -1ULL)
+    {
+        write_index_area(index_area, new_leaf_entries, first_changed_entry / BLOCKING_FACTOR, sparse_index);
+        fit_learned_index();
+    }
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::print_stats_after_operation(OperationType operation)
+{
+    std::cout << "Operation: " << operation << std::endl;
+    std::cout << "Index area reads: " << index_area.get_read_count() << "\n";
+    std::cout << "Index area writes: " << index_area.get_write_count() << "\n";
+
+    std::cout << "Main area reads: " << main_area.get_read_count() << "\n";
+    std::cout << "Main area writes: " << main_area.get_write_count() << "\n";
+
+    std::cout << "Overflow area reads: " << overflow_area.get_read_count() << "\n";
+    std::cout << "Overflow area writes: " << overflow_area.get_write_count() << "\n";
+
+    // Every guard taken during the operation should be released by now
+    buffer_pool.report_pinned_frames();
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::clear_counters()
+{
+    // Called at the start of every operation. Pages still held by an insert which triggered
+    // reorganisation are never evicted, so resizing the buffers here is safe.
+    buffer_pool.on_operation();
+
+    // Background reorganisation is installed by the first operation after it is done
+    if (background_reorganisation.valid() && background_reorganisation.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        finish_background_reorganisation();
+    }
+
+    main_area.clear_counters();
+    index_area.clear_counters();
+    overflow_area.clear_counters();
+}
+
+template <size_t BlockingFactor>
+std::optional<uint64_t> BasicDatabase<BlockingFactor>::search(uint64_t key)
+{
+    clear_counters();
+    auto result = search_wrapper(key);
+    print_stats_after_operation(OperationType::SEARCH);
+
+    return result;
+}
+
+template <size_t BlockingFactor>
+std::vector<std::optional<uint64_t>> BasicDatabase<BlockingFactor>::multi_search(std::span<const uint64_t> keys)
+{
+    clear_counters();
+    auto results = multi_search_wrapper(keys);
+    print_stats_after_operation(OperationType::MULTI_SEARCH);
+
+    return results;
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::insert(uint64_t key, uint64_t value)
+{
+    clear_counters();
+    insert_wrapper(key, value);
+    print_stats_after_operation(OperationType::INSERT);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::update(uint64_t key, uint64_t value)
+{
+    clear_counters();
+    update_wrapper(key, value);
+    print_stats_after_operation(OperationType::UPDATE);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::upsert(uint64_t key, uint64_t value)
+{
+    clear_counters();
+    conditional_write(key, value, WriteCondition::ALWAYS);
+    print_stats_after_operation(OperationType::UPSERT);
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::insert_if_absent(uint64_t key, uint64_t value)
+{
+    clear_counters();
+    bool inserted = conditional_write(key, value, WriteCondition::IF_ABSENT);
+    print_stats_after_operation(OperationType::INSERT_IF_ABSENT);
+
+    return inserted;
+}
+
+template <size_t BlockingFactor>
+bool BasicDatabase<BlockingFactor>::compare_and_set(uint64_t key, uint64_t expected, uint64_t value)
+{
+    clear_counters();
+    bool set = conditional_write(key, value, WriteCondition::IF_EQUAL, expected);
+    print_stats_after_operation(OperationType::COMPARE_AND_SET);
+
+    return set;
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::remove(uint64_t key)
+{
+    clear_counters();
+
+    remove_wrapper(key);
+    print_stats_after_operation(OperationType::REMOVE);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::reorganise()
+{
+    clear_counters();
+
+    reorganise_wrapper();
+    print_stats_after_operation(OperationType::REORGANISE);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::reorganise_incremental()
+{
+    clear_counters();
+
+    reorganise_incremental_wrapper();
+    print_stats_after_operation(OperationType::REORGANISE);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::bulk_load(KeyValueSource &source)
+{
+    clear_counters();
+    // Bulk load rewrites the files the same way, so it waits for background reorganisation and its delta instead
+    finish_background_reorganisation();
+
+    // New pairs are written together with the entries already there in a single pass
+    auto areas = build_reorganised_areas(index_area, main_area, overflow_area, guardian.overflow_page_index, &source);
+    install_reorganised_areas(areas);
+    print_stats_after_operation(OperationType::BULK_LOAD);
+}
+
+template <size_t BlockingFactor>
+std::unique_ptr<KeyValueSource> BasicDatabase<BlockingFactor>::scan(uint64_t lo, uint64_t hi)
+{
+    clear_counters();
+    // Background reorganisation keeps running, the scan reads the old areas and merges the delta into them
+    return std::make_unique<ScanCursor>(*this, lo, hi);
+}
+
+template <size_t BlockingFactor>
+void BasicDatabase<BlockingFactor>::flush()
+{
+    finish_background_reorganisation();
+    index_area.flush();
+    main_area.flush();
+    overflow_area.flush();
+    save_sidecar_files();
+    start_new_generation();
+}
+
+namespace
+{
+    template <size_t... BlockingFactors>
+    std::unique_ptr<DatabaseEngine> make_engine(size_t blocking_factor, const DatabaseOptions &options, std::index_sequence<BlockingFactors...>)
+    {
+        std::unique_ptr<DatabaseEngine> engine;
+        ((blocking_factor == BlockingFactors && (engine = std::make_unique<BasicDatabase<BlockingFactors>>(options), true)) || ...);
+        return engine;
+    }
+
+    template <size_t... BlockingFactors>
+    size_t largest_fitting_blocking_factor(size_t page_size, std::index_sequence<BlockingFactors...>)
+    {
+        size_t result = 0;
+        ((sizeof(Page<BlockingFactors>) <= page_size ? result = BlockingFactors : 0), ...);
+        return result;
+    }
+}
+
+std::unique_ptr<DatabaseEngine> make_database_engine(size_t blocking_factor, const DatabaseOptions &options)
+{
+    auto engine = make_engine(blocking_factor, options, SupportedBlockingFactors{});
+    if (!engine)
+    {
+        throw std::runtime_error("Unsupported blocking factor: " + std::to_string(blocking_factor));
+    }
+    return engine;
+}
+
+size_t blocking_factor_for_page_size(size_t page_size)
+{
+    size_t blocking_factor = largest_fitting_blocking_factor(page_size, SupportedBlockingFactors{});
+    if (blocking_factor == 0)
+    {
+        throw std::runtime_error("Page size " + std::to_string(page_size) + " is too small");
+    }
+    return blocking_factor;
+}
@@ -0,0 +1,96 @@
+#include "external_sort.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include "settings.hpp"
+
+ExternalSort::ExternalSort(std::istream &input)
+{
+    memory_run.reserve(Settings::EXTERNAL_SORT_RUN_PAIRS);
+    uint64_t key, value;
+    while (input >> key >> value)
+    {
+        if (memory_run.size() == Settings::EXTERNAL_SORT_RUN_PAIRS)
+        {
+            spill_run();
+        }
+        memory_run.emplace_back(key, value);
+    }
+    if (!input.eof())
+    {
+        throw std::runtime_error("Invalid key value pair in bulk load input");
+    }
+
+    std::stable_sort(memory_run.begin(), memory_run.end(), [](const auto &a, const auto &b)
+                     { return a.first < b.first; });
+
+    // Pairs in memory come last in the input, they form the last run
+    for (size_t run = 0; run <= runs.size(); ++run)
+    {
+        advance(run);
+    }
+}
+
+ExternalSort::~ExternalSort()
+{
+    runs.clear();
+    for (const auto &path : run_paths)
+    {
+        std::remove(path.c_str());
+    }
+}
+
+void ExternalSort::spill_run()
+{
+    std::stable_sort(memory_run.begin(), memory_run.end(), [](const auto &a, const auto &b)
+                     { return a.first < b.first; });
+
+    std::string path = std::string(Settings::TEMP_SORT_RUN_FILE_PATH) + std::to_string(run_paths.size()) + ".db";
+    run_paths.push_back(path);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(memory_run.data()), memory_run.size() * sizeof(memory_run[0]));
+        if (!file)
+        {
+            throw std::runtime_error("Failed to write sort run " + path);
+        }
+    }
+    runs.emplace_back(path, std::ios::binary);
+    memory_run.clear();
+}
+
+void ExternalSort::advance(size_t run)
+{
+    if (run == runs.size())
+    {
+        if (memory_run_position < memory_run.size())
+        {
+            const auto &[key, value] = memory_run[memory_run_position++];
+            heads.push({key, value, run});
+        }
+        return;
+    }
+
+    std::pair<uint64_t, uint64_t> pair;
+    if (runs[run].read(reinterpret_cast<char *>(&pair), sizeof(pair)))
+    {
+        heads.push({pair.first, pair.second, run});
+    }
+}
+
+bool ExternalSort::next(uint64_t &key, uint64_t &value)
+{
+    if (heads.empty())
+    {
+        return false;
+    }
+
+    Head head = heads.top();
+    heads.pop();
+    key = head.key;
+    value = head.value;
+    advance(head.run);
+    return true;
+}
@@ -0,0 +1,266 @@
+#include "file_backend.hpp"
+#include "debug.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+FstreamFileBackend::FstreamFileBackend(const std::string &path, bool truncate)
+{
+    auto mode = std::ios::in | std::ios::out | std::ios::binary;
+    if (truncate || !std::filesystem::exists(path))
+    {
+        mode |= std::ios::trunc;
+    }
+
+    file.open(path, mode);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    reset_pointers();
+}
+
+bool FstreamFileBackend::read(void *data, size_t size, size_t offset)
+{
+    size_t file_size = this->size();
+
+    if (file_size == 0 || file_size < offset + size)
+    {
+        DEBUG_CERR << "File is empty or too small to read " << size << " bytes at offset " << offset << std::endl;
+        return false;
+    }
+
+    file.seekg(offset);
+    file.read(static_cast<char *>(data), size); // Read directly into the buffer
+
+    return true;
+}
+
+bool FstreamFileBackend::write(const void *data, size_t size, size_t offset)
+{
+    // If file is too small, extend it first
+    if (this->size() < offset + size)
+    {
+        resize(offset + size);
+    }
+
+    file.seekp(offset);
+    file.write(static_cast<const char *>(data), size);
+    file.flush();
+    return true;
+}
+
+void FstreamFileBackend::flush()
+{
+    file.flush();
+}
+
+void FstreamFileBackend::close()
+{
+    flush();
+    file.close();
+}
+
+void FstreamFileBackend::open(const std::string &path)
+{
+    file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+}
+
+size_t FstreamFileBackend::size()
+{
+    file.seekg(0, std::ios::end);
+    std::streampos file_size = file.tellg();
+    return file_size <= 0 ? 0 : static_cast<size_t>(file_size);
+}
+
+void FstreamFileBackend::resize(size_t new_size)
+{
+    // Get current file size
+    size_t current_size = size();
+
+    if (new_size > current_size)
+    {
+        // Need to extend the file
+        file.seekp(0, std::ios::end);
+
+        // Write zeros to extend the file
+        char zero_buffer[4096] = {0}; // Use 4KB chunks for efficiency
+
+        while (current_size < new_size)
+        {
+            size_t bytes_to_write = std::min(sizeof(zero_buffer),
+                                             new_size - current_size);
+            file.write(zero_buffer, bytes_to_write);
+            if (file.fail())
+            {
+                throw std::runtime_error("Failed to extend file");
+            }
+            current_size += bytes_to_write;
+        }
+    }
+
+    // Reset pointers after resize
+    reset_pointers();
+}
+
+void FstreamFileBackend::reset_pointers()
+{
+    file.seekg(0, std::ios::beg);
+    file.seekp(0, std::ios::beg);
+
+    file.clear();
+}
+
+PosixFileBackend::PosixFileBackend(const std::string &path, bool truncate, bool direct_io)
+{
+    int flags = O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0);
+    if (direct_io)
+    {
+        fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+        if (fd != -1)
+        {
+            ::close(fd);
+            fd = -1;
+            extra_flags = O_DIRECT;
+        }
+        else
+        {
+            DEBUG_CERR << "O_DIRECT not supported for " << path << ", using the page cache" << std::endl;
+        }
+    }
+    open(path, flags);
+}
+
+PosixFileBackend::~PosixFileBackend()
+{
+    close();
+}
+
+bool PosixFileBackend::read(void *data, size_t size, size_t offset)
+{
+    if (file_size == 0 || file_size < offset + size)
+    {
+        DEBUG_CERR << "File is empty or too small to read " << size << " bytes at offset " << offset << std::endl;
+        return false;
+    }
+
+    char *char_data = static_cast<char *>(data);
+    while (size > 0)
+    {
+        ssize_t bytes_read = ::pread(fd, char_data, size, offset);
+        if (bytes_read < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_read <= 0)
+        {
+            throw std::runtime_error("Failed to read file: " + std::string(std::strerror(errno)));
+        }
+        char_data += bytes_read;
+        size -= bytes_read;
+        offset += bytes_read;
+    }
+    return true;
+}
+
+bool PosixFileBackend::write(const void *data, size_t size, size_t offset)
+{
+    // Writing past the end extends the file, the gap reads back as zeros
+    file_size = std::max(file_size, offset + size);
+
+    const char *char_data = static_cast<const char *>(data);
+    while (size > 0)
+    {
+        ssize_t bytes_written = ::pwrite(fd, char_data, size, offset);
+        if (bytes_written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (bytes_written < 0)
+        {
+            throw std::runtime_error("Failed to write file: " + std::string(std::strerror(errno)));
+        }
+        char_data += bytes_written;
+        size -= bytes_written;
+        offset += bytes_written;
+    }
+    return true;
+}
+
+void PosixFileBackend::flush()
+{
+    // Nothing is buffered in user space
+}
+
+void PosixFileBackend::close()
+{
+    if (fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void PosixFileBackend::open(const std::string &path)
+{
+    open(path, O_RDWR);
+}
+
+void PosixFileBackend::open(const std::string &path, int flags)
+{
+    close();
+    fd = ::open(path.c_str(), flags | extra_flags, 0644);
+    if (fd == -1)
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0)
+    {
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    file_size = file_stat.st_size;
+}
+
+size_t PosixFileBackend::size()
+{
+    return file_size;
+}
+
+void PosixFileBackend::resize(size_t new_size)
+{
+    if (new_size <= file_size)
+    {
+        return;
+    }
+
+    // Sparse extension, no zeros are written
+    if (::ftruncate(fd, new_size) != 0)
+    {
+        throw std::runtime_error("Failed to extend file");
+    }
+    file_size = new_size;
+}
+
+std::unique_ptr<FileBackend> make_file_backend(FileBackendType type, const std::string &path, bool truncate, bool direct_io)
+{
+    switch (type)
+    {
+    case FileBackendType::FSTREAM:
+        if (direct_io)
+        {
+            throw std::runtime_error("Direct I/O needs the POSIX file backend");
+        }
+        return std::make_unique<FstreamFileBackend>(path, truncate);
+    case FileBackendType::POSIX:
+        return std::make_unique<PosixFileBackend>(path, truncate, direct_io);
+    }
+    throw std::runtime_error("Unknown file backend");
+}
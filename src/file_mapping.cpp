@@ -0,0 +1,51 @@
+#include "file_mapping.hpp"
+#include "settings.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <sys/mman.h>
+
+FileMapping::FileMapping()
+{
+    void *reservation = ::mmap(nullptr, Settings::MAPPING_RESERVATION, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to reserve address space: " + std::string(std::strerror(errno)));
+    }
+    base = static_cast<char *>(reservation);
+}
+
+FileMapping::~FileMapping()
+{
+    ::munmap(base, Settings::MAPPING_RESERVATION);
+}
+
+void FileMapping::map(int fd, size_t size)
+{
+    if (size > Settings::MAPPING_RESERVATION)
+    {
+        throw std::runtime_error("File is larger than the reserved mapping");
+    }
+    if (size == 0)
+    {
+        return;
+    }
+
+    // Replaces the previous mapping in place, already mapped pages keep their addresses
+    if (::mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map file: " + std::string(std::strerror(errno)));
+    }
+    mapped_size = size;
+}
+
+void FileMapping::sync()
+{
+    if (mapped_size > 0 && ::msync(base, mapped_size, MS_SYNC) != 0)
+    {
+        throw std::runtime_error("Failed to sync mapping: " + std::string(std::strerror(errno)));
+    }
+}
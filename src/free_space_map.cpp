@@ -0,0 +1,134 @@
+#include "free_space_map.hpp"
+
+#include <bit>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    struct FreeSpaceMapHeader
+    {
+        uint64_t number_of_pages;
+        uint64_t generation;
+    };
+}
+
+void FreeSpaceMap::reset(size_t number_of_pages)
+{
+    this->number_of_pages = number_of_pages;
+    words.assign((number_of_pages + 63) / 64, ~0ULL);
+    // Bits past the last page stay clear, so they are never found
+    if (number_of_pages % 64 != 0)
+    {
+        words.back() = (1ULL << (number_of_pages % 64)) - 1;
+    }
+}
+
+void FreeSpaceMap::grow(size_t number_of_pages)
+{
+    size_t old_number_of_pages = this->number_of_pages;
+    this->number_of_pages = number_of_pages;
+    words.resize((number_of_pages + 63) / 64, 0);
+    for (size_t i = old_number_of_pages; i < number_of_pages; ++i)
+    {
+        set_has_room(i, true);
+    }
+}
+
+void FreeSpaceMap::set_has_room(size_t page_index, bool has_room)
+{
+    if (has_room)
+    {
+        words[page_index / 64] |= 1ULL << (page_index % 64);
+    }
+    else
+    {
+        words[page_index / 64] &= ~(1ULL << (page_index % 64));
+    }
+}
+
+bool FreeSpaceMap::has_room(size_t page_index) const
+{
+    return words[page_index / 64] & (1ULL << (page_index % 64));
+}
+
+size_t FreeSpaceMap::find_nearest(size_t page_index) const
+{
+    if (has_room(page_index))
+    {
+        return page_index;
+    }
+
+    // Nearest set bit at or above and below the page, a word at a time, moving outwards from the page's word
+    size_t word = page_index / 64;
+    uint64_t above = words[word] & (~0ULL << (page_index % 64));
+    uint64_t below = words[word] & ((1ULL << (page_index % 64)) - 1);
+    for (size_t distance = 0; distance <= words.size(); ++distance)
+    {
+        size_t candidate_above = -1ULL;
+        size_t candidate_below = -1ULL;
+        if (word + distance < words.size())
+        {
+            uint64_t bits = distance == 0 ? above : words[word + distance];
+            if (bits)
+            {
+                candidate_above = (word + distance) * 64 + std::countr_zero(bits);
+            }
+        }
+        if (distance <= word)
+        {
+            uint64_t bits = distance == 0 ? below : words[word - distance];
+            if (bits)
+            {
+                candidate_below = (word - distance) * 64 + 63 - std::countl_zero(bits);
+            }
+        }
+
+        if (candidate_above != -1ULL && candidate_below != -1ULL)
+        {
+            return candidate_above - page_index <= page_index - candidate_below ? candidate_above : candidate_below;
+        }
+        if (candidate_above != -1ULL)
+        {
+            return candidate_above;
+        }
+        if (candidate_below != -1ULL)
+        {
+            return candidate_below;
+        }
+    }
+    return -1ULL;
+}
+
+bool FreeSpaceMap::load(const std::string &path, size_t number_of_pages, uint64_t generation)
+{
+    std::ifstream file(path, std::ios::binary);
+    FreeSpaceMapHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(FreeSpaceMapHeader)) || header.number_of_pages != number_of_pages ||
+        header.generation != generation)
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> loaded_words((number_of_pages + 63) / 64);
+    if (!file.read(reinterpret_cast<char *>(loaded_words.data()), loaded_words.size() * sizeof(uint64_t)))
+    {
+        return false;
+    }
+
+    this->number_of_pages = number_of_pages;
+    words = std::move(loaded_words);
+    return true;
+}
+
+void FreeSpaceMap::save(const std::string &path, uint64_t generation) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    FreeSpaceMapHeader header{number_of_pages, generation};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(FreeSpaceMapHeader));
+    file.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(uint64_t));
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write overflow free space map");
+    }
+}
@@ -0,0 +1,372 @@
+#include "io_engine.hpp"
+#include "settings.hpp"
+#include "debug.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    int io_uring_setup(unsigned entries, io_uring_params *params)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    unsigned *ring_field(void *ring, unsigned offset)
+    {
+        return reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+    }
+}
+
+IoEngine &IoEngine::get()
+{
+    thread_local std::unique_ptr<IoEngine> engine = []() -> std::unique_ptr<IoEngine>
+    {
+        try
+        {
+            return make_io_engine(Settings::DEFAULT_IO_ENGINE);
+        }
+        catch (const std::exception &e)
+        {
+            DEBUG_CERR << "io_uring not available, using thread pool: " << e.what() << std::endl;
+            return make_io_engine(IoEngineType::THREAD_POOL);
+        }
+    }();
+    return *engine;
+}
+
+IoUringEngine::IoUringEngine(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0)
+    {
+        throw std::runtime_error("io_uring_setup failed: " + std::string(std::strerror(errno)));
+    }
+    sq_entries = params.sq_entries;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+    {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    cq_ring = single_mmap ? sq_ring : ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        ::close(ring_fd);
+        throw std::runtime_error("Failed to map io_uring rings");
+    }
+
+    sq_head = ring_field(sq_ring, params.sq_off.head);
+    sq_tail = ring_field(sq_ring, params.sq_off.tail);
+    sq_mask = ring_field(sq_ring, params.sq_off.ring_mask);
+    sq_array = ring_field(sq_ring, params.sq_off.array);
+    cq_head = ring_field(cq_ring, params.cq_off.head);
+    cq_tail = ring_field(cq_ring, params.cq_off.tail);
+    cq_mask = ring_field(cq_ring, params.cq_off.ring_mask);
+    cqes = static_cast<char *>(cq_ring) + params.cq_off.cqes;
+}
+
+IoUringEngine::~IoUringEngine()
+{
+    try
+    {
+        wait_all();
+    }
+    catch (const std::exception &e)
+    {
+        DEBUG_CERR << "Error: " << e.what() << std::endl;
+    }
+
+    ::munmap(sqes, sqes_size);
+    if (cq_ring != sq_ring)
+    {
+        ::munmap(cq_ring, cq_ring_size);
+    }
+    ::munmap(sq_ring, sq_ring_size);
+    ::close(ring_fd);
+}
+
+IoEngine::Ticket IoUringEngine::submit_read(int fd, void *data, size_t size, size_t offset)
+{
+    return submit(IORING_OP_READ, fd, data, size, offset);
+}
+
+IoEngine::Ticket IoUringEngine::submit_write(int fd, const void *data, size_t size, size_t offset)
+{
+    return submit(IORING_OP_WRITE, fd, data, size, offset);
+}
+
+IoEngine::Ticket IoUringEngine::submit(uint8_t opcode, int fd, const void *data, size_t size, size_t offset)
+{
+    // Completion queue is twice the submission queue, keeping at most this many requests unfinished never overflows it
+    while (in_flight.size() - completed.size() >= sq_entries)
+    {
+        enter(1);
+    }
+
+    unsigned tail = *sq_tail;
+    unsigned index = tail & *sq_mask;
+    auto *sqe = static_cast<io_uring_sqe *>(sqes) + index;
+    std::memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(size);
+    sqe->off = offset;
+
+    Ticket ticket = next_ticket++;
+    sqe->user_data = ticket;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    to_submit++;
+    in_flight[ticket] = size;
+    return ticket;
+}
+
+void IoUringEngine::enter(unsigned min_complete)
+{
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    while (true)
+    {
+        int submitted = io_uring_enter(ring_fd, to_submit, min_complete, flags);
+        if (submitted < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (submitted < 0)
+        {
+            throw std::runtime_error("io_uring_enter failed: " + std::string(std::strerror(errno)));
+        }
+        to_submit -= submitted;
+        break;
+    }
+    reap_completions();
+}
+
+void IoUringEngine::reap_completions()
+{
+    unsigned head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+    {
+        auto *cqe = static_cast<io_uring_cqe *>(cqes) + (head & *cq_mask);
+        completed[cqe->user_data] = cqe->res;
+        head++;
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+}
+
+void IoUringEngine::check_result(Ticket ticket)
+{
+    auto result = completed.find(ticket);
+    auto expected = in_flight.find(ticket);
+    int64_t bytes = result->second;
+    size_t expected_bytes = expected->second;
+    completed.erase(result);
+    in_flight.erase(expected);
+
+    if (bytes < 0)
+    {
+        throw std::runtime_error("Asynchronous I/O failed: " + std::string(std::strerror(-bytes)));
+    }
+    if (static_cast<size_t>(bytes) != expected_bytes)
+    {
+        throw std::runtime_error("Asynchronous I/O transferred " + std::to_string(bytes) + " of " + std::to_string(expected_bytes) + " bytes");
+    }
+}
+
+void IoUringEngine::wait(Ticket ticket)
+{
+    // Already waited for
+    if (!in_flight.contains(ticket))
+    {
+        return;
+    }
+
+    reap_completions();
+    while (!completed.contains(ticket))
+    {
+        enter(1);
+    }
+    check_result(ticket);
+}
+
+void IoUringEngine::wait_all()
+{
+    if (to_submit > 0)
+    {
+        enter(0);
+    }
+    while (completed.size() < in_flight.size())
+    {
+        enter(1);
+    }
+
+    std::vector<Ticket> tickets;
+    for (const auto &[ticket, result] : completed)
+    {
+        tickets.push_back(ticket);
+    }
+    for (Ticket ticket : tickets)
+    {
+        check_result(ticket);
+    }
+}
+
+ThreadPoolEngine::ThreadPoolEngine(size_t number_of_threads)
+{
+    for (size_t i = 0; i < number_of_threads; ++i)
+    {
+        threads.emplace_back(&ThreadPoolEngine::worker, this);
+    }
+}
+
+ThreadPoolEngine::~ThreadPoolEngine()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    request_available.notify_all();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+IoEngine::Ticket ThreadPoolEngine::submit_read(int fd, void *data, size_t size, size_t offset)
+{
+    return submit({0, false, fd, static_cast<char *>(data), size, offset});
+}
+
+IoEngine::Ticket ThreadPoolEngine::submit_write(int fd, const void *data, size_t size, size_t offset)
+{
+    return submit({0, true, fd, const_cast<char *>(static_cast<const char *>(data)), size, offset});
+}
+
+IoEngine::Ticket ThreadPoolEngine::submit(Request request)
+{
+    std::lock_guard lock(mutex);
+    request.ticket = next_ticket++;
+    requests.push_back(request);
+    pending.insert(request.ticket);
+    request_available.notify_one();
+    return request.ticket;
+}
+
+void ThreadPoolEngine::worker()
+{
+    while (true)
+    {
+        Request request;
+        {
+            std::unique_lock lock(mutex);
+            request_available.wait(lock, [this]
+                                   { return stopping || !requests.empty(); });
+            if (requests.empty())
+            {
+                return;
+            }
+            request = requests.front();
+            requests.pop_front();
+        }
+
+        bool succeeded = true;
+        while (request.size > 0)
+        {
+            ssize_t bytes = request.is_write ? ::pwrite(request.fd, request.data, request.size, request.offset)
+                                             : ::pread(request.fd, request.data, request.size, request.offset);
+            if (bytes < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (bytes <= 0)
+            {
+                succeeded = false;
+                break;
+            }
+            request.data += bytes;
+            request.size -= bytes;
+            request.offset += bytes;
+        }
+
+        {
+            std::lock_guard lock(mutex);
+            completed[request.ticket] = succeeded;
+            pending.erase(request.ticket);
+        }
+        request_done.notify_all();
+    }
+}
+
+void ThreadPoolEngine::wait(Ticket ticket)
+{
+    std::unique_lock lock(mutex);
+    request_done.wait(lock, [&]
+                      { return !pending.contains(ticket); });
+
+    // Already waited for
+    auto result = completed.find(ticket);
+    if (result == completed.end())
+    {
+        return;
+    }
+    bool succeeded = result->second;
+    completed.erase(result);
+    if (!succeeded)
+    {
+        throw std::runtime_error("Asynchronous I/O failed");
+    }
+}
+
+void ThreadPoolEngine::wait_all()
+{
+    std::unique_lock lock(mutex);
+    request_done.wait(lock, [this]
+                      { return pending.empty(); });
+
+    bool succeeded = true;
+    for (const auto &[ticket, result] : completed)
+    {
+        succeeded &= result;
+    }
+    completed.clear();
+    if (!succeeded)
+    {
+        throw std::runtime_error("Asynchronous I/O failed");
+    }
+}
+
+std::unique_ptr<IoEngine> make_io_engine(IoEngineType type)
+{
+    switch (type)
+    {
+    case IoEngineType::IO_URING:
+        return std::make_unique<IoUringEngine>(Settings::IO_QUEUE_DEPTH);
+    case IoEngineType::THREAD_POOL:
+        return std::make_unique<ThreadPoolEngine>(Settings::IO_THREAD_POOL_SIZE);
+    }
+    throw std::runtime_error("Unknown I/O engine");
+}
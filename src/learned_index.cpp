@@ -0,0 +1,100 @@
+#include "learned_index.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    struct LearnedIndexHeader
+    {
+        uint64_t number_of_keys;
+        uint64_t max_error;
+        uint64_t number_of_segments;
+    };
+}
+
+LearnedIndex::LearnedIndex(const std::vector<uint64_t> &keys, size_t max_error)
+    : number_of_keys(keys.size()), max_error(max_error)
+{
+    // Shrinking cone: a segment grows while some slope keeps every key within max_error of its position
+    size_t first = 0;
+    while (first < keys.size())
+    {
+        double min_slope = 0;
+        double max_slope = std::numeric_limits<double>::infinity();
+        size_t last = first + 1;
+        for (; last < keys.size(); ++last)
+        {
+            double distance = static_cast<double>(keys[last] - keys[first]);
+            double positions = static_cast<double>(last - first);
+            double low = (positions - static_cast<double>(max_error)) / distance;
+            double high = (positions + static_cast<double>(max_error)) / distance;
+            if (low > max_slope || high < min_slope)
+            {
+                break;
+            }
+            min_slope = std::max(min_slope, low);
+            max_slope = std::min(max_slope, high);
+        }
+
+        double slope = last == first + 1 ? 0 : (min_slope + max_slope) / 2;
+        segments.push_back({keys[first], first, slope});
+        first = last;
+    }
+}
+
+std::pair<size_t, size_t> LearnedIndex::predict_window(uint64_t key) const
+{
+    auto segment = std::upper_bound(segments.begin(), segments.end(), key, [](uint64_t key, const Segment &segment)
+                                    { return key < segment.first_key; });
+    if (segment == segments.begin())
+    {
+        return {0, 1};
+    }
+    // Keys past the last key of a segment belong to its last position, the model isn't fitted there
+    size_t last_position = segment == segments.end() ? number_of_keys - 1 : segment->first_position - 1;
+    --segment;
+
+    // Key between two fitted keys is predicted between their predictions, one more position on each side covers it
+    double prediction = static_cast<double>(segment->first_position) + segment->slope * static_cast<double>(key - segment->first_key);
+    size_t position = static_cast<size_t>(std::clamp(prediction, 0.0, static_cast<double>(last_position)));
+    size_t first = position > max_error + 1 ? position - max_error - 1 : 0;
+    size_t last = std::min<size_t>(number_of_keys, position + max_error + 2);
+    return {first, last};
+}
+
+bool LearnedIndex::load(const std::string &path, size_t number_of_keys)
+{
+    std::ifstream file(path, std::ios::binary);
+    LearnedIndexHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(LearnedIndexHeader)) || header.number_of_keys != number_of_keys)
+    {
+        return false;
+    }
+
+    std::vector<Segment> loaded_segments(header.number_of_segments);
+    if (!file.read(reinterpret_cast<char *>(loaded_segments.data()), loaded_segments.size() * sizeof(Segment)))
+    {
+        return false;
+    }
+
+    segments = std::move(loaded_segments);
+    this->number_of_keys = header.number_of_keys;
+    max_error = header.max_error;
+    return true;
+}
+
+void LearnedIndex::save(const std::string &path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    LearnedIndexHeader header{number_of_keys, max_error, segments.size()};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(LearnedIndexHeader));
+    file.write(reinterpret_cast<const char *>(segments.data()), segments.size() * sizeof(Segment));
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write learned index");
+    }
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <optional>
 
 #include "database.hpp"
 #include "command_parser.hpp"
@@ -14,12 +15,98 @@ int main(int argc, char *argv[])
 
     try
     {
-        Database db;
+        DatabaseOptions options;
+        std::optional<std::string> input_file;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            if (argument == "--memory-budget" && i + 1 < argc)
+            {
+                // Budget is given in bytes, like the page size
+                options.memory_budget = std::stoull(argv[++i]);
+            }
+            else if (argument == "--mmap")
+            {
+                options.index_and_main_storage = StorageMode::MAPPED;
+            }
+            else if (argument == "--blocking-factor" && i + 1 < argc)
+            {
+                // Only used when the database is created, existing files keep theirs
+                options.blocking_factor = std::stoull(argv[++i]);
+            }
+            else if (argument == "--page-size" && i + 1 < argc)
+            {
+                // Page size in bytes of the main area, converted to entries per page
+                options.blocking_factor = blocking_factor_for_page_size(std::stoull(argv[++i]));
+            }
+            else if (argument == "--direct-io")
+            {
+                options.buffer_options.direct_io = true;
+            }
+            else if (argument == "--index-mode" && i + 1 < argc)
+            {
+                std::string mode = argv[++i];
+                if (mode == "binary")
+                {
+                    options.index_mode = IndexMode::BINARY_SEARCH;
+                }
+                else if (mode == "learned")
+                {
+                    options.index_mode = IndexMode::LEARNED;
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown index mode: " + mode);
+                }
+            }
+            else if (argument == "--reorganisation" && i + 1 < argc)
+            {
+                std::string mode = argv[++i];
+                if (mode == "full")
+                {
+                    options.reorganisation_mode = ReorganisationMode::FULL;
+                }
+                else if (mode == "incremental")
+                {
+                    options.reorganisation_mode = ReorganisationMode::INCREMENTAL;
+                }
+                else if (mode == "background")
+                {
+                    options.reorganisation_mode = ReorganisationMode::BACKGROUND;
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown reorganisation mode: " + mode);
+                }
+            }
+            else if (argument == "--file-backend" && i + 1 < argc)
+            {
+                std::string backend = argv[++i];
+                if (backend == "fstream")
+                {
+                    options.buffer_options.file_backend = FileBackendType::FSTREAM;
+                }
+                else if (backend == "posix")
+                {
+                    options.buffer_options.file_backend = FileBackendType::POSIX;
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown file backend: " + backend);
+                }
+            }
+            else
+            {
+                input_file = argument;
+            }
+        }
+
+        Database db(options);
         CommandParser parser(db);
-        if (argc > 1)
+        if (input_file)
         {
             // Process commands from file
-            parser.run_from_file(argv[1]);
+            parser.run_from_file(*input_file);
         }
         else
         {
@@ -33,4 +120,4 @@ int main(int argc, char *argv[])
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
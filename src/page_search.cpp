@@ -0,0 +1,116 @@
+#include "page_search.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PAGE_SEARCH_X86 1
+#endif
+
+namespace
+{
+    size_t find_first_greater_scalar(const uint64_t *keys, size_t count, uint64_t key)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (keys[i] > key)
+            {
+                return i;
+            }
+        }
+        return count;
+    }
+
+#ifdef PAGE_SEARCH_X86
+    // There is no unsigned 64-bit compare, flipping the sign bit of both sides turns it into a signed one
+    constexpr uint64_t SIGN_BIT = 1ULL << 63;
+
+    __attribute__((target("sse4.2"))) size_t find_first_greater_sse42(const uint64_t *keys, size_t count, uint64_t key)
+    {
+        const __m128i sign = _mm_set1_epi64x(SIGN_BIT);
+        const __m128i needle = _mm_set1_epi64x(key ^ SIGN_BIT);
+
+        size_t i = 0;
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128i chunk = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i)), sign);
+            int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(chunk, needle)));
+            if (mask)
+            {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        return i + find_first_greater_scalar(keys + i, count - i, key);
+    }
+
+    __attribute__((target("avx2"))) size_t find_first_greater_avx2(const uint64_t *keys, size_t count, uint64_t key)
+    {
+        const __m256i sign = _mm256_set1_epi64x(SIGN_BIT);
+        const __m256i needle = _mm256_set1_epi64x(key ^ SIGN_BIT);
+
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i chunk = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i)), sign);
+            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(chunk, needle)));
+            if (mask)
+            {
+                return i + __builtin_ctz(mask);
+            }
+        }
+        return i + find_first_greater_scalar(keys + i, count - i, key);
+    }
+#endif
+
+    using Kernel = size_t (*)(const uint64_t *, size_t, uint64_t);
+
+    struct Dispatch
+    {
+        PageSearchKernel type;
+        Kernel function;
+    };
+
+    Dispatch select_kernel()
+    {
+#ifdef PAGE_SEARCH_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return {PageSearchKernel::AVX2, find_first_greater_avx2};
+        }
+        if (__builtin_cpu_supports("sse4.2"))
+        {
+            return {PageSearchKernel::SSE42, find_first_greater_sse42};
+        }
+#endif
+        return {PageSearchKernel::SCALAR, find_first_greater_scalar};
+    }
+
+    // Chosen before main, nothing searches pages during static initialisation
+    const Dispatch dispatch = select_kernel();
+}
+
+size_t find_first_greater(const uint64_t *keys, size_t count, uint64_t key)
+{
+    return dispatch.function(keys, count, key);
+}
+
+PageSearchKernel get_page_search_kernel()
+{
+    return dispatch.type;
+}
+
+std::ostream &operator<<(std::ostream &os, PageSearchKernel kernel)
+{
+    switch (kernel)
+    {
+    case PageSearchKernel::SCALAR:
+        os << "SCALAR";
+        break;
+    case PageSearchKernel::SSE42:
+        os << "SSE4.2";
+        break;
+    case PageSearchKernel::AVX2:
+        os << "AVX2";
+        break;
+    }
+    return os;
+}
@@ -0,0 +1,260 @@
+#include "replacement_policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    // Walk list from the least recently used end and return first frame that can be evicted
+    std::optional<size_t> find_evictable(const std::list<size_t> &frames, const ReplacementPolicy::IsEvictable &is_evictable)
+    {
+        for (auto it = frames.rbegin(); it != frames.rend(); ++it)
+        {
+            if (is_evictable(*it))
+            {
+                return *it;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void push_front(std::list<size_t> &list, std::unordered_map<size_t, std::list<size_t>::iterator> &positions, size_t value)
+    {
+        list.push_front(value);
+        positions[value] = list.begin();
+    }
+
+    bool erase(std::list<size_t> &list, std::unordered_map<size_t, std::list<size_t>::iterator> &positions, size_t value)
+    {
+        auto it = positions.find(value);
+        if (it == positions.end())
+        {
+            return false;
+        }
+        list.erase(it->second);
+        positions.erase(it);
+        return true;
+    }
+
+    void pop_back(std::list<size_t> &list, std::unordered_map<size_t, std::list<size_t>::iterator> &positions)
+    {
+        positions.erase(list.back());
+        list.pop_back();
+    }
+}
+
+ClockPolicy::ClockPolicy(size_t number_of_frames)
+    : occupied(number_of_frames, false), referenced(number_of_frames, false)
+{
+}
+
+void ClockPolicy::on_hit(size_t frame)
+{
+    referenced[frame] = true;
+}
+
+void ClockPolicy::on_load(size_t frame, size_t /*page_index*/)
+{
+    occupied[frame] = true;
+    referenced[frame] = true;
+}
+
+void ClockPolicy::on_evict(size_t frame, size_t /*page_index*/)
+{
+    occupied[frame] = false;
+    referenced[frame] = false;
+}
+
+std::optional<size_t> ClockPolicy::choose_victim(size_t /*incoming_page_index*/, const IsEvictable &is_evictable)
+{
+    // Two full rotations are enough - the first one clears all reference bits
+    for (size_t step = 0; step < 2 * occupied.size(); ++step)
+    {
+        size_t frame = hand;
+        hand = (hand + 1) % occupied.size();
+
+        if (!occupied[frame] || !is_evictable(frame))
+        {
+            continue;
+        }
+
+        if (referenced[frame])
+        {
+            referenced[frame] = false;
+            continue;
+        }
+
+        return frame;
+    }
+    return std::nullopt;
+}
+
+void ClockPolicy::reset()
+{
+    std::fill(occupied.begin(), occupied.end(), false);
+    std::fill(referenced.begin(), referenced.end(), false);
+    hand = 0;
+}
+
+TwoQueuePolicy::TwoQueuePolicy(size_t number_of_frames)
+    : max_a1_in(std::max<size_t>(1, number_of_frames / 4)), max_a1_out(std::max<size_t>(1, number_of_frames / 2))
+{
+}
+
+void TwoQueuePolicy::on_hit(size_t frame)
+{
+    // Pages in A1in are not promoted on hit, correlated references should not count as reuse
+    if (erase(am, am_frames, frame))
+    {
+        push_front(am, am_frames, frame);
+    }
+}
+
+void TwoQueuePolicy::on_load(size_t frame, size_t page_index)
+{
+    if (erase(a1_out, a1_out_pages, page_index))
+    {
+        push_front(am, am_frames, frame);
+        return;
+    }
+    push_front(a1_in, a1_in_frames, frame);
+}
+
+void TwoQueuePolicy::on_evict(size_t frame, size_t page_index)
+{
+    if (erase(a1_in, a1_in_frames, frame))
+    {
+        push_front(a1_out, a1_out_pages, page_index);
+        while (a1_out.size() > max_a1_out)
+        {
+            pop_back(a1_out, a1_out_pages);
+        }
+        return;
+    }
+    erase(am, am_frames, frame);
+}
+
+std::optional<size_t> TwoQueuePolicy::choose_victim(size_t /*incoming_page_index*/, const IsEvictable &is_evictable)
+{
+    auto &preferred = a1_in.size() > max_a1_in ? a1_in : am;
+    auto &other = &preferred == &a1_in ? am : a1_in;
+
+    if (auto frame = find_evictable(preferred, is_evictable))
+    {
+        return frame;
+    }
+    return find_evictable(other, is_evictable);
+}
+
+void TwoQueuePolicy::reset()
+{
+    a1_in.clear();
+    am.clear();
+    a1_out.clear();
+    a1_in_frames.clear();
+    am_frames.clear();
+    a1_out_pages.clear();
+}
+
+ArcPolicy::ArcPolicy(size_t number_of_frames) : capacity(number_of_frames)
+{
+}
+
+void ArcPolicy::on_hit(size_t frame)
+{
+    if (erase(t1, t1_frames, frame) || erase(t2, t2_frames, frame))
+    {
+        push_front(t2, t2_frames, frame);
+    }
+}
+
+void ArcPolicy::on_load(size_t frame, size_t page_index)
+{
+    if (b1_pages.contains(page_index))
+    {
+        // Recently evicted from T1 - recency list is too small
+        target_t1 = std::min(capacity, target_t1 + std::max<size_t>(1, b2.size() / b1.size()));
+        erase(b1, b1_pages, page_index);
+        push_front(t2, t2_frames, frame);
+    }
+    else if (b2_pages.contains(page_index))
+    {
+        // Recently evicted from T2 - frequency list is too small
+        size_t delta = std::max<size_t>(1, b1.size() / b2.size());
+        target_t1 = target_t1 > delta ? target_t1 - delta : 0;
+        erase(b2, b2_pages, page_index);
+        push_front(t2, t2_frames, frame);
+    }
+    else
+    {
+        push_front(t1, t1_frames, frame);
+    }
+    trim_ghosts();
+}
+
+void ArcPolicy::on_evict(size_t frame, size_t page_index)
+{
+    if (erase(t1, t1_frames, frame))
+    {
+        push_front(b1, b1_pages, page_index);
+    }
+    else if (erase(t2, t2_frames, frame))
+    {
+        push_front(b2, b2_pages, page_index);
+    }
+    trim_ghosts();
+}
+
+std::optional<size_t> ArcPolicy::choose_victim(size_t incoming_page_index, const IsEvictable &is_evictable)
+{
+    bool evict_from_t1 = !t1.empty() &&
+                         (t1.size() > target_t1 || (b2_pages.contains(incoming_page_index) && t1.size() == target_t1));
+
+    auto &preferred = evict_from_t1 ? t1 : t2;
+    auto &other = evict_from_t1 ? t2 : t1;
+
+    if (auto frame = find_evictable(preferred, is_evictable))
+    {
+        return frame;
+    }
+    return find_evictable(other, is_evictable);
+}
+
+void ArcPolicy::reset()
+{
+    t1.clear();
+    t2.clear();
+    b1.clear();
+    b2.clear();
+    t1_frames.clear();
+    t2_frames.clear();
+    b1_pages.clear();
+    b2_pages.clear();
+    target_t1 = 0;
+}
+
+void ArcPolicy::trim_ghosts()
+{
+    while (!b1.empty() && t1.size() + b1.size() > capacity)
+    {
+        pop_back(b1, b1_pages);
+    }
+    while (!b2.empty() && t1.size() + t2.size() + b1.size() + b2.size() > 2 * capacity)
+    {
+        pop_back(b2, b2_pages);
+    }
+}
+
+std::unique_ptr<ReplacementPolicy> make_replacement_policy(ReplacementPolicyType type, size_t number_of_frames)
+{
+    switch (type)
+    {
+    case ReplacementPolicyType::CLOCK:
+        return std::make_unique<ClockPolicy>(number_of_frames);
+    case ReplacementPolicyType::TWO_Q:
+        return std::make_unique<TwoQueuePolicy>(number_of_frames);
+    case ReplacementPolicyType::ARC:
+        return std::make_unique<ArcPolicy>(number_of_frames);
+    }
+    throw std::runtime_error("Unknown replacement policy");
+}
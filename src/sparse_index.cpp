@@ -0,0 +1,81 @@
+#include "sparse_index.hpp"
+
+void SparseIndex::clear()
+{
+    start_keys.clear();
+    page_indices.clear();
+    model.reset();
+}
+
+void SparseIndex::append(uint64_t start_key, uint64_t page_index)
+{
+    start_keys.push_back(start_key);
+    page_indices.push_back(page_index);
+    model.reset();
+}
+
+size_t SparseIndex::find(uint64_t key) const
+{
+    size_t position = find_position(key);
+    return position == -1ULL ? -1ULL : page_indices[position];
+}
+
+size_t SparseIndex::find_position(uint64_t key) const
+{
+    if (start_keys.empty() || key < start_keys[0])
+    {
+        return -1ULL;
+    }
+
+    if (model)
+    {
+        auto [first, last] = model->predict_window(key);
+        size_t position = search(key, first, last);
+        if (start_keys[position] <= key && (position + 1 == start_keys.size() || start_keys[position + 1] > key))
+        {
+            return position;
+        }
+        model_fallbacks++;
+    }
+
+    return search(key, 0, start_keys.size());
+}
+
+size_t SparseIndex::search(uint64_t key, size_t first, size_t last) const
+{
+    // Branchless binary search, the comparison only selects the next base,
+    // which compiles to a conditional move
+    const uint64_t *base = start_keys.data() + first;
+    size_t length = last - first;
+    while (length > 1)
+    {
+        size_t half = length / 2;
+        base = base[half] <= key ? base + half : base;
+        length -= half;
+    }
+    return base - start_keys.data();
+}
+
+void SparseIndex::fit_model(size_t max_error)
+{
+    model.emplace(start_keys, max_error);
+}
+
+bool SparseIndex::load_model(const std::string &path)
+{
+    LearnedIndex loaded;
+    if (!loaded.load(path, start_keys.size()))
+    {
+        return false;
+    }
+    model = std::move(loaded);
+    return true;
+}
+
+void SparseIndex::save_model(const std::string &path) const
+{
+    if (model)
+    {
+        model->save(path);
+    }
+}
@@ -1,6 +1,8 @@
 #include "utils.hpp"
 
+#include <fstream>
 #include <random>
+#include <stdexcept>
 #include <sstream>
 #include <iomanip>
 
@@ -45,4 +47,37 @@ uint64_t generate_key()
 {
     static std::mt19937 gen(std::random_device{}());
     return gen();
+}
+
+bool load_counters(const std::string &path, std::vector<uint64_t> &counters, size_t number_of_counters, uint64_t generation)
+{
+    std::ifstream file(path, std::ios::binary);
+    uint64_t stored_generation;
+    uint64_t stored_size;
+    if (!file.read(reinterpret_cast<char *>(&stored_generation), sizeof(uint64_t)) || stored_generation != generation ||
+        !file.read(reinterpret_cast<char *>(&stored_size), sizeof(uint64_t)) || stored_size != number_of_counters)
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> loaded(number_of_counters);
+    if (!file.read(reinterpret_cast<char *>(loaded.data()), loaded.size() * sizeof(uint64_t)))
+    {
+        return false;
+    }
+    counters = std::move(loaded);
+    return true;
+}
+
+void save_counters(const std::string &path, const std::vector<uint64_t> &counters, uint64_t generation)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    uint64_t size = counters.size();
+    file.write(reinterpret_cast<const char *>(&generation), sizeof(uint64_t));
+    file.write(reinterpret_cast<const char *>(&size), sizeof(uint64_t));
+    file.write(reinterpret_cast<const char *>(counters.data()), counters.size() * sizeof(uint64_t));
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
 }
\ No newline at end of file